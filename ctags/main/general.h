@@ -40,6 +40,17 @@
 #endif
 
 
+/*  Storage class of the variables holding the state of a running parse. Each
+ *  thread gets its own copy so that parsers not sharing any other state can
+ *  run on several threads at once.
+ */
+#if defined (_MSC_VER)
+# define CTAGS_THREAD_LOCAL __declspec(thread)
+#else
+# define CTAGS_THREAD_LOCAL __thread
+#endif
+
+
 /*  MS-DOS doesn't allow manipulation of standard error, so we send it to
  *  stdout instead.
  */
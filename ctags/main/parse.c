@@ -40,8 +40,8 @@ static kindOption defaultFileKind = {
 	.description = KIND_FILE_DEFAULT_LONG,
 };
 
-tagEntryFunction TagEntryFunction = NULL;
-void *TagEntryUserData = NULL;
+CTAGS_THREAD_LOCAL tagEntryFunction TagEntryFunction = NULL;
+CTAGS_THREAD_LOCAL void *TagEntryUserData = NULL;
 
 /*
 *   FUNCTION DEFINITIONS
@@ -153,8 +153,8 @@ extern void checkRegex (void);
 
 
 /* Extra stuff for Tag Manager */
-extern tagEntryFunction TagEntryFunction;
-extern void *TagEntryUserData;
+extern CTAGS_THREAD_LOCAL tagEntryFunction TagEntryFunction;
+extern CTAGS_THREAD_LOCAL void *TagEntryUserData;
 extern void setTagEntryFunction(tagEntryFunction entry_function, void *user_data);
 
 #endif  /* CTAGS_MAIN_PARSE_H */
@@ -28,8 +28,8 @@
 /*
 *   DATA DEFINITIONS
 */
-inputFile File;                 /* globally read through macros */
-static MIOPos StartOfLine;      /* holds deferred position of start of line */
+CTAGS_THREAD_LOCAL inputFile File;             /* globally read through macros */
+static CTAGS_THREAD_LOCAL MIOPos StartOfLine;  /* holds deferred position of start of line */
 
 
 /*
@@ -93,7 +93,7 @@ typedef struct sInputFile {
 *   GLOBAL VARIABLES
 */
 /* should not be modified externally */
-extern inputFile File;
+extern CTAGS_THREAD_LOCAL inputFile File;
 
 /*
 *   FUNCTION PROTOTYPES
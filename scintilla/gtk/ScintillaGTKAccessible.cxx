@@ -95,6 +95,7 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "BlockVector.h"
 #include "RunStyles.h"
 #include "ContractionState.h"
 #include "CellBuffer.h"
@@ -48,6 +48,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_START 2000
 #define SCI_OPTIONAL_START 3000
 #define SCI_LEXER_START 4000
+#define SCI_GEANY_START 7700
 #define SCI_ADDTEXT 2001
 #define SCI_ADDSTYLEDTEXT 2002
 #define SCI_INSERTTEXT 2003
@@ -69,6 +70,9 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_MARKERLINEFROMHANDLE 2017
 #define SCI_MARKERDELETEHANDLE 2018
 #define SCI_GETUNDOCOLLECTION 2019
+#define SCI_SETUNDOMEMORYLIMIT 7700
+#define SCI_GETUNDOMEMORYLIMIT 7701
+#define SCI_GETUNDODISCARDED 7703
 #define SCWS_INVISIBLE 0
 #define SCWS_VISIBLEALWAYS 1
 #define SCWS_VISIBLEAFTERINDENT 2
@@ -834,6 +838,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_GETCHARACTERPOINTER 2520
 #define SCI_GETRANGEPOINTER 2643
 #define SCI_GETGAPPOSITION 2644
+#define SCI_GETSEGMENTEND 7702
 #define SCI_INDICSETALPHA 2523
 #define SCI_INDICGETALPHA 2524
 #define SCI_INDICSETOUTLINEALPHA 2558
@@ -1095,6 +1100,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCN_FOCUSOUT 2029
 #define SCN_AUTOCCOMPLETED 2030
 #define SCN_MARGINRIGHTCLICK 2031
+#define SCN_WRAPPROGRESS 7750
 /* --Autogenerated -- end of section automatically generated from Scintilla.iface */
 
 /* These structures are defined to be exactly the same shape as the Win32
@@ -1142,6 +1148,7 @@ struct Sci_RangeToFormat {
  * is not required in C++ code and actually seems to break ScintillaEditPy */
 typedef struct Sci_NotifyHeader Sci_NotifyHeader;
 typedef struct SCNotification SCNotification;
+typedef struct Sci_WordSet Sci_WordSet;
 #endif
 
 struct Sci_NotifyHeader {
@@ -1192,6 +1199,18 @@ struct SCNotification {
 	/* SCN_AUTOCSELECTION, SCN_AUTOCCOMPLETED, SCN_USERLISTSELECTION, */
 };
 
+/* A set of words owned by the container which a lexer looks up in addition to one
+ * of its keyword lists, so that big lists which change often are not passed as strings.
+ * It is set with SCI_PRIVATELEXERCALL(SC_LEXERCALL_SETWORDSET + keyword list, set) which
+ * returns the set if the lexer supports it and 0 otherwise. Setting 0 removes it.
+ * The container keeps the set alive while it is used and restyles the text affected
+ * when words are added or removed. The operations are in the Geany private range. */
+#define SC_LEXERCALL_SETWORDSET 7780
+
+struct Sci_WordSet {
+	int (*contains)(const struct Sci_WordSet *set, const char *word);
+};
+
 #ifdef INCLUDE_DEPRECATED_FEATURES
 
 #define SCI_SETKEYSUNICODE 2521
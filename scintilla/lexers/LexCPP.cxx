@@ -229,8 +229,12 @@ struct PPDefinition {
 	std::string value;
 	bool isUndef;
 	std::string arguments;
+	// What key was before this definition, so it can be undone
+	bool wasDefined;
+	std::string previousValue;
+	std::string previousArguments;
 	PPDefinition(Sci_Position line_, const std::string &key_, const std::string &value_, bool isUndef_ = false, const std::string &arguments_="") :
-		line(line_), key(key_), value(value_), isUndef(isUndef_), arguments(arguments_) {
+		line(line_), key(key_), value(value_), isUndef(isUndef_), arguments(arguments_), wasDefined(false) {
 	}
 };
 
@@ -450,6 +454,7 @@ class LexerCPP : public ILexerWithSubStyles {
 	WordList keywords4;
 	WordList ppDefinitions;
 	WordList markerList;
+	const Sci_WordSet *typeNames;	// Container's words added to keywords4
 	struct SymbolValue {
 		std::string value;
 		std::string arguments;
@@ -466,6 +471,10 @@ class LexerCPP : public ILexerWithSubStyles {
 	};
 	typedef std::map<std::string, SymbolValue> SymbolTable;
 	SymbolTable preprocessorDefinitionsStart;
+	// preprocessorDefinitionsStart with ppDefineHistory applied
+	SymbolTable preprocessorDefinitions;
+	// Tokens of recent #if and #elif expressions
+	std::map<std::string, std::vector<std::string> > expressionTokens;
 	OptionsCPP options;
 	OptionSetCPP osCPP;
 	EscapeSequence escapeSeq;
@@ -481,6 +490,7 @@ public:
 		setArithmethicOp(CharacterSet::setNone, "+-/*%"),
 		setRelOp(CharacterSet::setNone, "=!<>"),
 		setLogicalOp(CharacterSet::setNone, "|&"),
+		typeNames(0),
 		subStyles(styleSubable, 0x80, 0x40, activeFlag) {
 	}
 	virtual ~LexerCPP() {
@@ -508,7 +518,12 @@ public:
 	void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess);
 	void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess);
 
-	void * SCI_METHOD PrivateCall(int, void *) {
+	void * SCI_METHOD PrivateCall(int operation, void *pointer) {
+		// Only the global classes and typedefs list can be extended by a word set
+		if (operation == SC_LEXERCALL_SETWORDSET + 3) {
+			typeNames = static_cast<const Sci_WordSet *>(pointer);
+			return pointer;
+		}
 		return 0;
 	}
 
@@ -555,6 +570,9 @@ public:
 	static int MaskActive(int style) {
 		return style & ~activeFlag;
 	}
+	void AddDefinition(const PPDefinition &definition);
+	bool TruncateDefinitions(Sci_Position line);
+	void ResetDefinitions();
 	void EvaluateTokens(std::vector<std::string> &tokens, const SymbolTable &preprocessorDefinitions);
 	std::vector<std::string> Tokenize(const std::string &expr) const;
 	bool EvaluateExpression(const std::string &expr, const SymbolTable &preprocessorDefinitions);
@@ -567,6 +585,7 @@ Sci_Position SCI_METHOD LexerCPP::PropertySet(const char *key, const char *val)
 			if (options.identifiersAllowDollars) {
 				setWord.Add('$');
 			}
+			expressionTokens.clear();
 		}
 		return 0;
 	}
@@ -627,20 +646,52 @@ Sci_Position SCI_METHOD LexerCPP::WordListSet(int n, const char *wl) {
 						preprocessorDefinitionsStart[name] = val;
 					}
 				}
+				ResetDefinitions();
 			}
 		}
 	}
 	return firstModification;
 }
 
-// Functor used to truncate history
-struct After {
-	Sci_Position line;
-	explicit After(Sci_Position line_) : line(line_) {}
-	bool operator()(PPDefinition &p) const {
-		return p.line > line;
+// Apply a #define or #undef to preprocessorDefinitions and append it to ppDefineHistory
+// with the symbol it replaced.
+void LexerCPP::AddDefinition(const PPDefinition &definition) {
+	ppDefineHistory.push_back(definition);
+	PPDefinition &added = ppDefineHistory.back();
+	SymbolTable::iterator it = preprocessorDefinitions.find(added.key);
+	if (it != preprocessorDefinitions.end()) {
+		added.wasDefined = true;
+		added.previousValue = it->second.value;
+		added.previousArguments = it->second.arguments;
+		if (added.isUndef)
+			preprocessorDefinitions.erase(it);
+		else
+			it->second = SymbolValue(added.value, added.arguments);
+	} else if (!added.isUndef) {
+		preprocessorDefinitions[added.key] = SymbolValue(added.value, added.arguments);
 	}
-};
+}
+
+// Undo the definitions made after line, latest first, so preprocessorDefinitions is as it
+// was at the end of line without copying the whole table.
+bool LexerCPP::TruncateDefinitions(Sci_Position line) {
+	bool truncated = false;
+	while (!ppDefineHistory.empty() && (ppDefineHistory.back().line > line)) {
+		const PPDefinition &last = ppDefineHistory.back();
+		if (last.wasDefined)
+			preprocessorDefinitions[last.key] = SymbolValue(last.previousValue, last.previousArguments);
+		else
+			preprocessorDefinitions.erase(last.key);
+		ppDefineHistory.pop_back();
+		truncated = true;
+	}
+	return truncated;
+}
+
+void LexerCPP::ResetDefinitions() {
+	ppDefineHistory.clear();
+	preprocessorDefinitions = preprocessorDefinitionsStart;
+}
 
 void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int initStyle, IDocument *pAccess) {
 	LexAccessor styler(pAccess);
@@ -700,21 +751,10 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 	// Truncate ppDefineHistory before current line
 
 	if (!options.updatePreprocessor)
-		ppDefineHistory.clear();
+		TruncateDefinitions(-1);
 
-	std::vector<PPDefinition>::iterator itInvalid = std::find_if(ppDefineHistory.begin(), ppDefineHistory.end(), After(lineCurrent-1));
-	if (itInvalid != ppDefineHistory.end()) {
-		ppDefineHistory.erase(itInvalid, ppDefineHistory.end());
+	if (TruncateDefinitions(lineCurrent-1))
 		definitionsChanged = true;
-	}
-
-	SymbolTable preprocessorDefinitions = preprocessorDefinitionsStart;
-	for (std::vector<PPDefinition>::iterator itDef = ppDefineHistory.begin(); itDef != ppDefineHistory.end(); ++itDef) {
-		if (itDef->isUndef)
-			preprocessorDefinitions.erase(itDef->key);
-		else
-			preprocessorDefinitions[itDef->key] = SymbolValue(itDef->value, itDef->arguments);
-	}
 
 	std::string rawStringTerminator = rawStringTerminators.ValueAt(lineCurrent-1);
 	SparseState<std::string> rawSTNew(lineCurrent);
@@ -810,12 +850,13 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 					} else {
 						sc.GetCurrentLowered(s, sizeof(s));
 					}
-					if (keywords.InList(s)) {
+					const unsigned int hash = WordList::Hash(s);
+					if (keywords.InList(s, hash)) {
 						lastWordWasUUID = strcmp(s, "uuid") == 0;
 						sc.ChangeState(SCE_C_WORD|activitySet);
-					} else if (keywords2.InList(s)) {
+					} else if (keywords2.InList(s, hash)) {
 						sc.ChangeState(SCE_C_WORD2|activitySet);
-					} else if (keywords4.InList(s)) {
+					} else if (keywords4.InList(s, hash) || (typeNames && typeNames->contains(typeNames, s))) {
 						sc.ChangeState(SCE_C_GLOBALCLASS|activitySet);
 					} else {
 						int subStyle = classifierIdentifiers.ValueFor(s);
@@ -1237,8 +1278,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 									std::string value;
 									if (startValue < restOfLine.length())
 										value = restOfLine.substr(startValue);
-									preprocessorDefinitions[key] = SymbolValue(value, args);
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, value, false, args));
+									AddDefinition(PPDefinition(lineCurrent, key, value, false, args));
 									definitionsChanged = true;
 								} else {
 									// Value
@@ -1246,8 +1286,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 									while ((startValue < restOfLine.length()) && IsSpaceOrTab(restOfLine[startValue]))
 										startValue++;
 									std::string value = restOfLine.substr(startValue);
-									preprocessorDefinitions[key] = value;
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, value));
+									AddDefinition(PPDefinition(lineCurrent, key, value));
 									definitionsChanged = true;
 								}
 							}
@@ -1257,8 +1296,7 @@ void SCI_METHOD LexerCPP::Lex(Sci_PositionU startPos, Sci_Position length, int i
 								std::vector<std::string> tokens = Tokenize(restOfLine);
 								if (tokens.size() >= 1) {
 									const std::string key = tokens[0];
-									preprocessorDefinitions.erase(key);
-									ppDefineHistory.push_back(PPDefinition(lineCurrent, key, "", true));
+									AddDefinition(PPDefinition(lineCurrent, key, "", true));
 									definitionsChanged = true;
 								}
 							}
@@ -1626,7 +1664,14 @@ std::vector<std::string> LexerCPP::Tokenize(const std::string &expr) const {
 }
 
 bool LexerCPP::EvaluateExpression(const std::string &expr, const SymbolTable &preprocessorDefinitions) {
-	std::vector<std::string> tokens = Tokenize(expr);
+	// The same conditions are evaluated again whenever the lines after an edit are restyled
+	std::map<std::string, std::vector<std::string> >::const_iterator itTokens = expressionTokens.find(expr);
+	if (itTokens == expressionTokens.end()) {
+		if (expressionTokens.size() >= 1000)
+			expressionTokens.clear();
+		itTokens = expressionTokens.insert(std::make_pair(expr, Tokenize(expr))).first;
+	}
+	std::vector<std::string> tokens = itTokens->second;
 
 	EvaluateTokens(tokens, preprocessorDefinitions);
 
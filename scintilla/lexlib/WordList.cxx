@@ -65,7 +65,7 @@ static char **ArrayFromWordList(char *wordlist, int *len, bool onlyLineEnds = fa
 }
 
 WordList::WordList(bool onlyLineEnds_) :
-	words(0), list(0), len(0), onlyLineEnds(onlyLineEnds_) {
+	words(0), list(0), len(0), onlyLineEnds(onlyLineEnds_), hashTable(0), hashMask(0) {
 	// Prevent warnings by static analyzers about uninitialized starts.
 	starts[0] = -1;
 }
@@ -97,9 +97,12 @@ void WordList::Clear() {
 		delete []list;
 		delete []words;
 	}
+	delete []hashTable;
 	words = 0;
 	list = 0;
 	len = 0;
+	hashTable = 0;
+	hashMask = 0;
 }
 
 #ifdef _MSC_VER
@@ -136,6 +139,37 @@ void WordList::Set(const char *s) {
 		unsigned char indexChar = words[l][0];
 		starts[indexChar] = l;
 	}
+	BuildHashTable();
+}
+
+/**
+ * Hashes the words into an open addressing table at most half full so that
+ * lookups do not depend on how many words start with the same character.
+ * Lists of type names supplied by applications can have many thousands of words.
+ */
+void WordList::BuildHashTable() {
+	unsigned int size = 16;
+	while (size < static_cast<unsigned int>(len) * 2)
+		size *= 2;
+	hashTable = new int[size];
+	hashMask = size - 1;
+	std::fill(hashTable, hashTable + size, -1);
+	for (int l = 0; l < len; l++) {
+		unsigned int slot = Hash(words[l]) & hashMask;
+		while (hashTable[slot] >= 0)
+			slot = (slot + 1) & hashMask;
+		hashTable[slot] = l;
+	}
+}
+
+// FNV-1a
+unsigned int WordList::Hash(const char *s) {
+	unsigned int hash = 2166136261u;
+	for (; *s; s++) {
+		hash ^= static_cast<unsigned char>(*s);
+		hash *= 16777619u;
+	}
+	return hash;
 }
 
 /** Check whether a string is in the list.
@@ -146,24 +180,25 @@ void WordList::Set(const char *s) {
 bool WordList::InList(const char *s) const {
 	if (0 == words)
 		return false;
-	unsigned char firstChar = s[0];
-	int j = starts[firstChar];
-	if (j >= 0) {
-		while (static_cast<unsigned char>(words[j][0]) == firstChar) {
-			if (s[1] == words[j][1]) {
-				const char *a = words[j] + 1;
-				const char *b = s + 1;
-				while (*a && *a == *b) {
-					a++;
-					b++;
-				}
-				if (!*a && !*b)
-					return true;
-			}
-			j++;
+	// Only hash when a word could match
+	if ((starts[static_cast<unsigned char>(s[0])] < 0) && (starts[static_cast<unsigned int>('^')] < 0))
+		return false;
+	return InList(s, Hash(s));
+}
+
+/** InList with the hash of s already computed by Hash.
+ */
+bool WordList::InList(const char *s, unsigned int hash) const {
+	if (0 == words)
+		return false;
+	// No need to probe when no word starts with the same character
+	if (starts[static_cast<unsigned char>(s[0])] >= 0) {
+		for (unsigned int slot = hash & hashMask; hashTable[slot] >= 0; slot = (slot + 1) & hashMask) {
+			if (strcmp(words[hashTable[slot]], s) == 0)
+				return true;
 		}
 	}
-	j = starts[static_cast<unsigned int>('^')];
+	int j = starts[static_cast<unsigned int>('^')];
 	if (j >= 0) {
 		while (words[j][0] == '^') {
 			const char *a = words[j] + 1;
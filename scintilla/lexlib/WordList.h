@@ -21,6 +21,9 @@ class WordList {
 	int len;
 	bool onlyLineEnds;	///< Delimited by any white space or only line ends
 	int starts[256];
+	int *hashTable;	///< Indices of the words by hash, -1 for empty slots
+	unsigned int hashMask;
+	void BuildHashTable();
 public:
 	explicit WordList(bool onlyLineEnds_ = false);
 	~WordList();
@@ -29,7 +32,10 @@ public:
 	int Length() const;
 	void Clear();
 	void Set(const char *s);
+	/// Hash of s for InList, so a word can be checked against several lists hashing it once.
+	static unsigned int Hash(const char *s);
 	bool InList(const char *s) const;
+	bool InList(const char *s, unsigned int hash) const;
 	bool InListAbbreviated(const char *s, const char marker) const;
 	bool InListAbridged(const char *s, const char marker) const;
 	const char *WordAt(int n) const;
@@ -0,0 +1,321 @@
+// Scintilla source code edit control
+/** @file BlockVector.h
+ ** Data structure for holding large arrays as a sequence of split vectors so that
+ ** insertions and deletions far apart stay cheap.
+ **/
+// Copyright 2026 by The Geany contributors
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef BLOCKVECTOR_H
+#define BLOCKVECTOR_H
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+/// An array stored in blocks, each a SplitVector, with the block start positions held
+/// in a Partitioning.
+/// Initially all elements are in a single block so this behaves like a SplitVector.
+/// Once a block length is set, modifications only move elements inside blocks of about
+/// that length instead of moving the gap across the whole array.
+/// Retrieving a pointer to a range that spans blocks merges them into one block, which
+/// is split again when it is next modified.
+
+template <typename T>
+class BlockVector {
+private:
+	std::vector<SplitVector<T> *> blocks;
+	Partitioning starts;
+	int lengthBody;
+	int blockLength;	/// 0 while blocks are not split
+	mutable int lastBlock;	/// Cache for sequential access
+
+	// Private so BlockVector objects can not be copied
+	BlockVector(const BlockVector &);
+	BlockVector &operator=(const BlockVector &);
+
+	int BlockStart(int block) const {
+		return starts.PositionFromPartition(block);
+	}
+
+	int BlockFromPosition(int position) const {
+		if (blocks.size() == 1)
+			return 0;
+		if ((position >= BlockStart(lastBlock)) && (position < BlockStart(lastBlock + 1)))
+			return lastBlock;
+		lastBlock = starts.PartitionFromPosition(position);
+		return lastBlock;
+	}
+
+	/// Move the elements from offset to the end of block into a new block following it.
+	void SplitBlock(int block, int offset) {
+		SplitVector<T> *body = blocks[block];
+		const int tailLength = body->Length() - offset;
+		SplitVector<T> *tail = new SplitVector<T>();
+		tail->InsertFromArray(0, body->RangePointer(offset, tailLength), 0, tailLength);
+		body->DeleteRange(offset, tailLength);
+		blocks.insert(blocks.begin() + block + 1, tail);
+		starts.InsertPartition(block + 1, BlockStart(block) + offset);
+	}
+
+	/// Split a block which was merged into blocks of blockLength.
+	void Fragment(int block) {
+		// Splitting from the end only moves the gap once
+		while (blocks[block]->Length() > blockLength) {
+			SplitBlock(block, blocks[block]->Length() - blockLength);
+		}
+		// Release the allocation which held the whole merged block
+		SplitVector<T> *body = new SplitVector<T>();
+		body->InsertFromArray(0, blocks[block]->RangePointer(0, blocks[block]->Length()), 0,
+			blocks[block]->Length());
+		delete blocks[block];
+		blocks[block] = body;
+		lastBlock = 0;
+	}
+
+	/// Append the elements of the blocks following first up to last to first.
+	void Merge(int first, int last) {
+		SplitVector<T> *body = blocks[first];
+		body->ReAllocate(BlockStart(last + 1) - BlockStart(first) + 1);
+		for (int block = first + 1; block <= last; block++) {
+			const int length = blocks[block]->Length();
+			body->InsertFromArray(body->Length(), blocks[block]->RangePointer(0, length), 0, length);
+			delete blocks[block];
+			starts.RemovePartition(first + 1);
+		}
+		blocks.erase(blocks.begin() + first + 1, blocks.begin() + last + 1);
+		lastBlock = 0;
+	}
+
+	/// Remove a block after deleting all of its elements.
+	void RemoveEmptyBlock(int block) {
+		delete blocks[block];
+		blocks.erase(blocks.begin() + block);
+		// The start of the empty block is the same as the start of the following one
+		starts.RemovePartition((block > 0) ? block : 1);
+		lastBlock = 0;
+	}
+
+	/// Return the block to modify at position, first splitting it if it was merged.
+	int BlockForModification(int position) {
+		int block = BlockFromPosition(position);
+		if ((blockLength > 0) && (blocks[block]->Length() > 2 * blockLength)) {
+			Fragment(block);
+			block = BlockFromPosition(position);
+		}
+		return block;
+	}
+
+	void InsertedIntoBlock(int block, int insertLength) {
+		starts.InsertText(block, insertLength);
+		lengthBody += insertLength;
+		if ((blockLength > 0) && (blocks[block]->Length() > 2 * blockLength)) {
+			SplitBlock(block, blocks[block]->Length() / 2);
+		}
+	}
+
+	int InsertionChunk(int insertLength) const {
+		return ((blockLength > 0) && (insertLength > blockLength)) ? blockLength : insertLength;
+	}
+
+	void Init() {
+		blocks.push_back(new SplitVector<T>());
+		lengthBody = 0;
+		lastBlock = 0;
+	}
+
+public:
+	BlockVector() : starts(8), blockLength(0) {
+		Init();
+	}
+
+	~BlockVector() {
+		for (size_t block = 0; block < blocks.size(); block++) {
+			delete blocks[block];
+		}
+	}
+
+	/// Split the array into blocks of about blockLength_ elements from now on.
+	void SetBlockLength(int blockLength_) {
+		if ((blockLength_ > 0) && (blockLength == 0)) {
+			blockLength = blockLength_;
+			for (size_t block = 0; block < blocks.size(); block++) {
+				if (blocks[block]->Length() > 2 * blockLength)
+					Fragment(static_cast<int>(block));
+			}
+		}
+	}
+
+	int Blocks() const {
+		return static_cast<int>(blocks.size());
+	}
+
+	/// Reserve room for newSize elements while they are held in a single block.
+	void ReAllocate(int newSize) {
+		if (blockLength == 0)
+			blocks[0]->ReAllocate(newSize);
+	}
+
+	/// Retrieve the element at a particular position.
+	/// Retrieving positions outside the range of the buffer returns 0.
+	T ValueAt(int position) const {
+		if (blocks.size() == 1)
+			return blocks[0]->ValueAt(position);
+		if ((position < 0) || (position >= lengthBody))
+			return 0;
+		const int block = BlockFromPosition(position);
+		return blocks[block]->ValueAt(position - BlockStart(block));
+	}
+
+	void SetValueAt(int position, T v) {
+		if (blocks.size() == 1) {
+			blocks[0]->SetValueAt(position, v);
+		} else if ((position >= 0) && (position < lengthBody)) {
+			const int block = BlockFromPosition(position);
+			blocks[block]->SetValueAt(position - BlockStart(block), v);
+		}
+	}
+
+	/// Retrieve the length of the buffer.
+	int Length() const {
+		return lengthBody;
+	}
+
+	/// Insert a number of elements into the buffer setting their value.
+	/// Inserting at positions outside the current range fails.
+	void InsertValue(int position, int insertLength, T v) {
+		PLATFORM_ASSERT((position >= 0) && (position <= lengthBody));
+		if ((position < 0) || (position > lengthBody)) {
+			return;
+		}
+		while (insertLength > 0) {
+			const int block = BlockForModification(position);
+			const int chunk = InsertionChunk(insertLength);
+			blocks[block]->InsertValue(position - BlockStart(block), chunk, v);
+			InsertedIntoBlock(block, chunk);
+			position += chunk;
+			insertLength -= chunk;
+		}
+	}
+
+	/// Insert text into the buffer from an array.
+	void InsertFromArray(int positionToInsert, const T s[], int positionFrom, int insertLength) {
+		PLATFORM_ASSERT((positionToInsert >= 0) && (positionToInsert <= lengthBody));
+		if ((positionToInsert < 0) || (positionToInsert > lengthBody)) {
+			return;
+		}
+		while (insertLength > 0) {
+			const int block = BlockForModification(positionToInsert);
+			const int chunk = InsertionChunk(insertLength);
+			blocks[block]->InsertFromArray(positionToInsert - BlockStart(block), s, positionFrom, chunk);
+			InsertedIntoBlock(block, chunk);
+			positionToInsert += chunk;
+			positionFrom += chunk;
+			insertLength -= chunk;
+		}
+	}
+
+	/// Delete a range from the buffer.
+	/// Deleting positions outside the current range fails.
+	void DeleteRange(int position, int deleteLength) {
+		PLATFORM_ASSERT((position >= 0) && (position + deleteLength <= lengthBody));
+		if ((position < 0) || ((position + deleteLength) > lengthBody)) {
+			return;
+		}
+		if ((position == 0) && (deleteLength == lengthBody)) {
+			DeleteAll();
+			return;
+		}
+		while (deleteLength > 0) {
+			int block = BlockFromPosition(position);
+			const int lengthBlock = blocks[block]->Length();
+			if ((Blocks() > 1) && (position == BlockStart(block)) && (deleteLength >= lengthBlock)) {
+				// Whole block deleted so it does not need to be split first
+				starts.InsertText(block, -lengthBlock);
+				lengthBody -= lengthBlock;
+				deleteLength -= lengthBlock;
+				RemoveEmptyBlock(block);
+				continue;
+			}
+			block = BlockForModification(position);
+			const int offset = position - BlockStart(block);
+			const int lengthDelete = std::min(deleteLength, blocks[block]->Length() - offset);
+			blocks[block]->DeleteRange(offset, lengthDelete);
+			starts.InsertText(block, -lengthDelete);
+			lengthBody -= lengthDelete;
+			deleteLength -= lengthDelete;
+			if ((Blocks() > 1) && (blocks[block]->Length() == 0))
+				RemoveEmptyBlock(block);
+		}
+		if (blockLength > 0) {
+			// Join the blocks before and after the deletion when they are short
+			const int block = BlockFromPosition((position > 0) ? position - 1 : 0);
+			if ((block + 1 < Blocks()) &&
+				(blocks[block]->Length() + blocks[block + 1]->Length() <= blockLength)) {
+				Merge(block, block + 1);
+			}
+		}
+	}
+
+	/// Delete all the buffer contents.
+	void DeleteAll() {
+		for (size_t block = 0; block < blocks.size(); block++) {
+			delete blocks[block];
+		}
+		blocks.clear();
+		starts.DeleteAll();
+		Init();
+	}
+
+	// Retrieve a range of elements into an array
+	void GetRange(T *buffer, int position, int retrieveLength) const {
+		while (retrieveLength > 0) {
+			const int block = BlockFromPosition(position);
+			const int offset = position - BlockStart(block);
+			const int lengthRetrieve = std::min(retrieveLength, blocks[block]->Length() - offset);
+			blocks[block]->GetRange(buffer, offset, lengthRetrieve);
+			buffer += lengthRetrieve;
+			position += lengthRetrieve;
+			retrieveLength -= lengthRetrieve;
+		}
+	}
+
+	T *BufferPointer() {
+		if (blocks.size() > 1)
+			Merge(0, Blocks() - 1);
+		return blocks[0]->BufferPointer();
+	}
+
+	T *RangePointer(int position, int rangeLength) {
+		const int block = BlockFromPosition(position);
+		if ((rangeLength > 0) && (position + rangeLength > BlockStart(block + 1))) {
+			// Range spans blocks so make it contiguous
+			Merge(block, BlockFromPosition(position + rangeLength - 1));
+		}
+		return blocks[block]->RangePointer(position - BlockStart(block), rangeLength);
+	}
+
+	int GapPosition() const {
+		if (blocks.size() == 1)
+			return blocks[0]->GapPosition();
+		// There is no single gap, any range spanning blocks has to be merged
+		return lengthBody;
+	}
+
+	/// Return the end of the range starting at position which is contiguous in memory
+	/// so can be retrieved with RangePointer without moving any elements.
+	int SegmentEnd(int position) const {
+		const int block = BlockFromPosition(position);
+		const int blockStart = BlockStart(block);
+		const int gap = blockStart + blocks[block]->GapPosition();
+		if (position < gap)
+			return gap;
+		return blockStart + blocks[block]->Length();
+	}
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+#endif
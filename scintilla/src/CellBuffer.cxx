@@ -11,6 +11,7 @@
 #include <stdarg.h>
 
 #include <stdexcept>
+#include <vector>
 #include <algorithm>
 
 #include "Platform.h"
@@ -19,6 +20,7 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "BlockVector.h"
 #include "CellBuffer.h"
 #include "UniConversion.h"
 
@@ -85,34 +87,26 @@ Action::~Action() {
 	Destroy();
 }
 
-void Action::Create(actionType at_, int position_, const char *data_, int lenData_, bool mayCoalesce_) {
-	delete []data;
-	data = NULL;
+void Action::Create(actionType at_, int position_, char *data_, int lenData_, bool mayCoalesce_) {
 	position = position_;
 	at = at_;
-	if (lenData_) {
-		data = new char[lenData_];
-		memcpy(data, data_, lenData_);
-	}
+	data = data_;
 	lenData = lenData_;
 	mayCoalesce = mayCoalesce_;
 }
 
 void Action::Destroy() {
-	delete []data;
 	data = 0;
+	lenData = 0;
 }
 
 void Action::Grab(Action *source) {
-	delete []data;
-
 	position = source->position;
 	at = source->at;
 	data = source->data;
 	lenData = source->lenData;
 	mayCoalesce = source->mayCoalesce;
 
-	// Ownership of source data transferred to this
 	source->position = 0;
 	source->at = startAction;
 	source->data = 0;
@@ -120,6 +114,82 @@ void Action::Grab(Action *source) {
 	source->mayCoalesce = true;
 }
 
+namespace {
+
+// Most actions are a few characters so allocate their text in blocks of this size
+const size_t undoBlockSize = 0x10000;
+
+}
+
+UndoMemory::UndoMemory() : allocated(0) {
+}
+
+UndoMemory::~UndoMemory() {
+	ReleaseAfter(0);
+}
+
+void UndoMemory::AddBlock(size_t size) {
+	Block block;
+	block.data = new char[size];
+	block.size = size;
+	block.used = 0;
+	blocks.push_back(block);
+	allocated += size;
+}
+
+void UndoMemory::FreeBlock(size_t block) {
+	allocated -= blocks[block].size;
+	delete []blocks[block].data;
+	blocks.erase(blocks.begin() + block);
+}
+
+char *UndoMemory::Allocate(size_t length) {
+	if (blocks.empty() || (blocks.back().used + length > blocks.back().size)) {
+		AddBlock(std::max(undoBlockSize, length));
+	}
+	Block &last = blocks.back();
+	char *data = last.data + last.used;
+	last.used += length;
+	return data;
+}
+
+char *UndoMemory::Grow(char *data, size_t length, size_t extra) {
+	Block &last = blocks.back();
+	PLATFORM_ASSERT(data + length == last.data + last.used);
+	if (last.used + extra <= last.size) {
+		last.used += extra;
+		return data;
+	}
+	// The text moves to a new block where it has room to keep growing so that a long
+	// stream of typing is not copied for each character
+	last.used -= length;
+	AddBlock(std::max(undoBlockSize, 2 * (length + extra)));
+	char *moved = Allocate(length + extra);
+	memcpy(moved, data, length);
+	return moved;
+}
+
+void UndoMemory::ReleaseAfter(const char *end) {
+	while (!blocks.empty()) {
+		Block &last = blocks.back();
+		if (end && (end > last.data) && (end <= last.data + last.used)) {
+			last.used = end - last.data;
+			return;
+		}
+		FreeBlock(blocks.size() - 1);
+	}
+}
+
+void UndoMemory::ReleaseBefore(const char *start) {
+	while (!blocks.empty()) {
+		const Block &first = blocks.front();
+		if (start && (start >= first.data) && (start < first.data + first.used)) {
+			return;
+		}
+		FreeBlock(0);
+	}
+}
+
 // The undo history stores a sequence of user operations that represent the user's view of the
 // commands executed on the text.
 // Each user operation contains a sequence of text insertion and text deletion actions.
@@ -137,6 +207,10 @@ void Action::Grab(Action *source) {
 // operation. If there is no outstanding BeginUndoAction call then a new operation is started
 // unless it looks as if the new action is caused by the user typing or deleting a stream of text.
 // Sequences that look like typing or deletion are coalesced into a single user operation.
+// When an insertion or deletion continues the previous action of the same operation, its text is
+// added to that action instead of recording another action.
+// The text of the actions is held in an UndoMemory. If a memory limit is set, the oldest user
+// operations are discarded once the history grows beyond it.
 
 UndoHistory::UndoHistory() {
 
@@ -147,6 +221,8 @@ UndoHistory::UndoHistory() {
 	undoSequenceDepth = 0;
 	savePoint = 0;
 	tentativePoint = -1;
+	memoryLimit = 0;
+	discarded = 0;
 
 	actions[currentAction].Create(startAction);
 }
@@ -171,6 +247,59 @@ void UndoHistory::EnsureUndoRoom() {
 	}
 }
 
+void UndoHistory::ReleaseRedoMemory() {
+	// Actions from currentAction on are being replaced so only the text up to the end of the
+	// last earlier action with text is still needed
+	int act = currentAction - 1;
+	while ((act > 0) && (actions[act].lenData == 0)) {
+		act--;
+	}
+	memory.ReleaseAfter((act >= 0) && actions[act].lenData ? actions[act].data + actions[act].lenData : 0);
+}
+
+size_t UndoHistory::MemoryUse() const {
+	return memory.Allocated() + lenActions * sizeof(Action);
+}
+
+// Discard the oldest user operations, keeping the one starting after lastStart.
+void UndoHistory::TrimHistory(int lastStart) {
+	// Go down to 3/4 of the limit so trimming is not repeated for every operation
+	const size_t target = memoryLimit / 4 * 3;
+	const size_t use = MemoryUse();
+	size_t released = 0;
+	int cut = 0;
+	for (int act = 1; act <= lastStart; act++) {
+		released += actions[act].lenData;
+		if (actions[act].at == startAction) {
+			cut = act;
+			if (use - released <= target)
+				break;
+		}
+	}
+	if (cut == 0)
+		return;
+
+	for (int act = 0; act < cut; act++) {
+		if (actions[act].at == startAction && actions[act + 1].at != startAction)
+			discarded++;
+	}
+
+	// The start action at cut becomes the first action
+	for (int act = cut; act <= maxAction; act++)
+		actions[act - cut].Grab(&actions[act]);
+	currentAction -= cut;
+	maxAction -= cut;
+	// A save point in the discarded operations can not be reached any more
+	savePoint = (savePoint >= cut) ? savePoint - cut : -1;
+
+	const char *firstData = 0;
+	for (int act = 0; (act <= maxAction) && !firstData; act++) {
+		if (actions[act].lenData)
+			firstData = actions[act].data;
+	}
+	memory.ReleaseBefore(firstData);
+}
+
 const char *UndoHistory::AppendAction(actionType at, int position, const char *data, int lengthData,
 	bool &startSequence, bool mayCoalesce) {
 	EnsureUndoRoom();
@@ -239,12 +368,45 @@ const char *UndoHistory::AppendAction(actionType at, int position, const char *d
 		currentAction++;
 	}
 	startSequence = oldCurrentAction != currentAction;
-	int actionWithData = currentAction;
-	actions[currentAction].Create(at, position, data, lengthData, mayCoalesce);
+	ReleaseRedoMemory();
+
+	if (!startSequence && (lengthData > 0) && (currentAction != savePoint) && !TentativeActive()) {
+		// Add the text to the previous action when it continues it
+		Action &previous = actions[currentAction - 1];
+		if ((previous.at == at) && (previous.lenData > 0)) {
+			const bool append = (at == insertAction) ?
+				(position == (previous.position + previous.lenData)) : (position == previous.position);
+			const bool prepend = (at == removeAction) && ((position + lengthData) == previous.position);
+			if (append || prepend) {
+				previous.data = memory.Grow(previous.data, previous.lenData, lengthData);
+				char *added = previous.data + previous.lenData;
+				if (prepend) {
+					// Backspace removes text in front of the previous removal
+					memmove(previous.data + lengthData, previous.data, previous.lenData);
+					added = previous.data;
+					previous.position = position;
+				}
+				memcpy(added, data, lengthData);
+				previous.lenData += lengthData;
+				maxAction = currentAction;
+				return added;
+			}
+		}
+	}
+
+	char *dataNew = 0;
+	if (lengthData > 0) {
+		dataNew = memory.Allocate(lengthData);
+		memcpy(dataNew, data, lengthData);
+	}
+	actions[currentAction].Create(at, position, dataNew, lengthData, mayCoalesce);
 	currentAction++;
 	actions[currentAction].Create(startAction);
 	maxAction = currentAction;
-	return actions[actionWithData].data;
+	if (startSequence && (memoryLimit > 0) && !TentativeActive() && (MemoryUse() > memoryLimit)) {
+		TrimHistory(currentAction - 2);
+	}
+	return dataNew;
 }
 
 void UndoHistory::BeginUndoAction() {
@@ -286,6 +448,11 @@ void UndoHistory::DeleteUndoHistory() {
 	actions[currentAction].Create(startAction);
 	savePoint = 0;
 	tentativePoint = -1;
+	memory.ReleaseAfter(0);
+}
+
+void UndoHistory::SetMemoryLimit(size_t limit) {
+	memoryLimit = limit;
 }
 
 void UndoHistory::SetSavePoint() {
@@ -421,7 +588,11 @@ int CellBuffer::GapPosition() const {
 	return substance.GapPosition();
 }
 
-// The char* returned is to an allocation owned by the undo history
+int CellBuffer::SegmentEnd(int position) const {
+	return substance.SegmentEnd(position);
+}
+
+// The char* returned is to text owned by the undo history
 const char *CellBuffer::InsertString(int position, const char *s, int insertLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	const char *data = s;
@@ -462,7 +633,7 @@ bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue) {
 	return changed;
 }
 
-// The char* returned is to an allocation owned by the undo history
+// The char* returned is to text owned by the undo history
 const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	PLATFORM_ASSERT(deleteLength > 0);
@@ -470,9 +641,16 @@ const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startS
 	if (!readOnly) {
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
-			// The gap would be moved to position anyway for the deletion so this doesn't cost extra
-			data = substance.RangePointer(position, deleteLength);
-			data = uh.AppendAction(removeAction, position, data, deleteLength, startSequence);
+			if (substance.Blocks() == 1) {
+				// The gap would be moved to position anyway for the deletion so this doesn't cost extra
+				data = substance.RangePointer(position, deleteLength);
+				data = uh.AppendAction(removeAction, position, data, deleteLength, startSequence);
+			} else {
+				// Copy rather than merging blocks which are about to be deleted
+				std::vector<char> deleted(deleteLength);
+				substance.GetRange(&deleted[0], position, deleteLength);
+				data = uh.AppendAction(removeAction, position, &deleted[0], deleteLength, startSequence);
+			}
 		}
 
 		BasicDeleteChars(position, deleteLength);
@@ -485,10 +663,22 @@ int CellBuffer::Length() const {
 }
 
 void CellBuffer::Allocate(int newSize) {
+	CheckLargeDocument(newSize);
 	substance.ReAllocate(newSize);
 	style.ReAllocate(newSize);
 }
 
+// Large documents are stored in blocks so that edits far apart do not move the whole gap
+static const int largeDocumentLength = 16 * 1024 * 1024;
+static const int blockLength = 64 * 1024;
+
+void CellBuffer::CheckLargeDocument(int length) {
+	if (length >= largeDocumentLength) {
+		substance.SetBlockLength(blockLength);
+		style.SetBlockLength(blockLength);
+	}
+}
+
 void CellBuffer::SetLineEndTypes(int utf8LineEnds_) {
 	if (utf8LineEnds != utf8LineEnds_) {
 		utf8LineEnds = utf8LineEnds_;
@@ -631,6 +821,7 @@ void CellBuffer::BasicInsertString(int position, const char *s, int insertLength
 		breakingUTF8LineEnd = UTF8LineEndOverlaps(position);
 	}
 
+	CheckLargeDocument(substance.Length() + insertLength);
 	substance.InsertFromArray(position, s, 0, insertLength);
 	style.InsertValue(position, insertLength, 0);
 
@@ -792,6 +983,18 @@ void CellBuffer::DeleteUndoHistory() {
 	uh.DeleteUndoHistory();
 }
 
+void CellBuffer::SetUndoMemoryLimit(size_t limit) {
+	uh.SetMemoryLimit(limit);
+}
+
+size_t CellBuffer::GetUndoMemoryLimit() const {
+	return uh.GetMemoryLimit();
+}
+
+int CellBuffer::GetUndoDiscarded() const {
+	return uh.Discarded();
+}
+
 bool CellBuffer::CanUndo() const {
 	return uh.CanUndo();
 }
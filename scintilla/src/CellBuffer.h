@@ -58,17 +58,53 @@ class Action {
 public:
 	actionType at;
 	int position;
-	char *data;
+	char *data;	///< Text owned by the UndoMemory of the history
 	int lenData;
 	bool mayCoalesce;
 
 	Action();
 	~Action();
-	void Create(actionType at_, int position_=0, const char *data_=0, int lenData_=0, bool mayCoalesce_=true);
+	void Create(actionType at_, int position_=0, char *data_=0, int lenData_=0, bool mayCoalesce_=true);
 	void Destroy();
 	void Grab(Action *source);
 };
 
+/**
+ * Holds the text of undo actions in large blocks rather than in an allocation per action.
+ * Text is allocated in the order of the actions so it can be released from the end when
+ * redo actions are discarded and from the start when the oldest actions are trimmed.
+ * Blocks are never moved so pointers to the text stay valid until it is released.
+ */
+class UndoMemory {
+	struct Block {
+		char *data;
+		size_t size;
+		size_t used;
+	};
+	std::vector<Block> blocks;
+	size_t allocated;
+
+	void AddBlock(size_t size);
+	void FreeBlock(size_t block);
+
+	// Private so UndoMemory objects can not be copied
+	UndoMemory(const UndoMemory &);
+
+public:
+	UndoMemory();
+	~UndoMemory();
+
+	char *Allocate(size_t length);
+	/// Make room for extra more bytes after the most recently allocated text, moving it
+	/// if the block it is in is full.
+	char *Grow(char *data, size_t length, size_t extra);
+	/// Release the text allocated after end, or all text when end is NULL.
+	void ReleaseAfter(const char *end);
+	/// Release the blocks allocated before the one holding start, or all when start is NULL.
+	void ReleaseBefore(const char *start);
+	size_t Allocated() const { return allocated; }
+};
+
 /**
  *
  */
@@ -80,8 +116,14 @@ class UndoHistory {
 	int undoSequenceDepth;
 	int savePoint;
 	int tentativePoint;
+	UndoMemory memory;
+	size_t memoryLimit;
+	int discarded;
 
 	void EnsureUndoRoom();
+	void ReleaseRedoMemory();
+	size_t MemoryUse() const;
+	void TrimHistory(int lastStart);
 
 	// Private so UndoHistory objects can not be copied
 	UndoHistory(const UndoHistory &);
@@ -97,6 +139,13 @@ public:
 	void DropUndoSequence();
 	void DeleteUndoHistory();
 
+	/// When the history uses more memory than the limit, the oldest user operations are
+	/// discarded. The most recent operation is always kept. 0 means no limit.
+	void SetMemoryLimit(size_t limit);
+	size_t GetMemoryLimit() const { return memoryLimit; }
+	/// Number of user operations discarded so far to stay within the limit.
+	int Discarded() const { return discarded; }
+
 	/// The save point is a marker in the undo stack where the container has stated that
 	/// the buffer was saved. Undo and redo can move over the save point.
 	void SetSavePoint();
@@ -127,8 +176,8 @@ public:
  */
 class CellBuffer {
 private:
-	SplitVector<char> substance;
-	SplitVector<char> style;
+	BlockVector<char> substance;
+	BlockVector<char> style;
 	bool readOnly;
 	int utf8LineEnds;
 
@@ -139,6 +188,7 @@ private:
 
 	bool UTF8LineEndOverlaps(int position) const;
 	void ResetLineEnds();
+	void CheckLargeDocument(int length);
 	/// Actions without undo
 	void BasicInsertString(int position, const char *s, int insertLength);
 	void BasicDeleteChars(int position, int deleteLength);
@@ -156,6 +206,7 @@ public:
 	const char *BufferPointer();
 	const char *RangePointer(int position, int rangeLength);
 	int GapPosition() const;
+	int SegmentEnd(int position) const;
 
 	int Length() const;
 	void Allocate(int newSize);
@@ -196,6 +247,9 @@ public:
 	void EndUndoAction();
 	void AddUndoAction(int token, bool mayCoalesce);
 	void DeleteUndoHistory();
+	void SetUndoMemoryLimit(size_t limit);
+	size_t GetUndoMemoryLimit() const;
+	int GetUndoDiscarded() const;
 
 	/// To perform an undo, StartUndo is called to retrieve the number of steps, then UndoStep is
 	/// called that many times. Similarly for redo.
@@ -16,6 +16,14 @@
 #include <vector>
 #include <algorithm>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCI_SSE2_SEARCH
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
 #define NOEXCEPT
 
 #ifndef NO_CXX11_REGEX
@@ -38,6 +46,7 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "BlockVector.h"
 #include "RunStyles.h"
 #include "CellBuffer.h"
 #include "PerLine.h"
@@ -103,6 +112,8 @@ Document::Document() {
 	dbcsCodePage = 0;
 	lineEndBitSet = SC_LINE_END_TYPE_DEFAULT;
 	endStyled = 0;
+	startStyledSpeculative = 0;
+	endStyledSpeculative = 0;
 	styleClock = 0;
 	enteredModification = 0;
 	enteredStyling = 0;
@@ -1021,6 +1032,11 @@ EncodingFamily Document::CodePageFamily() const {
 void Document::ModifiedAt(int pos) {
 	if (endStyled > pos)
 		endStyled = pos;
+	if (endStyledSpeculative > pos) {
+		// Style the modified range again when it is next shown
+		startStyledSpeculative = 0;
+		endStyledSpeculative = 0;
+	}
 }
 
 void Document::CheckReadOnly() {
@@ -1833,6 +1849,144 @@ Document::CharacterExtracted Document::ExtractCharacter(int position) const {
 	}
 }
 
+#ifdef SCI_SSE2_SEARCH
+static inline int LowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+/**
+ * Find the first occurrence of needle starting at one of the first candidates
+ * bytes of haystack, which must extend for lengthNeedle - 1 bytes after them.
+ * Returns the offset of the match or -1.
+ */
+static int FindLiteral(const char *haystack, int candidates, const char *needle, int lengthNeedle) {
+	int i = 0;
+#ifdef SCI_SSE2_SEARCH
+	if (lengthNeedle > 1) {
+		// Only look closer at positions where both the first and the last byte match
+		const __m128i first = _mm_set1_epi8(needle[0]);
+		const __m128i last = _mm_set1_epi8(needle[lengthNeedle - 1]);
+		for (; i + 16 <= candidates; i += 16) {
+			const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+			const __m128i blockLast = _mm_loadu_si128(
+				reinterpret_cast<const __m128i *>(haystack + i + lengthNeedle - 1));
+			unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+				_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+			while (mask) {
+				const int offset = i + LowestBit(mask);
+				if (memcmp(haystack + offset + 1, needle + 1, lengthNeedle - 2) == 0)
+					return offset;
+				mask &= mask - 1;
+			}
+		}
+	}
+#endif
+	while (i < candidates) {
+		const char *found = static_cast<const char *>(
+			memchr(haystack + i, static_cast<unsigned char>(needle[0]), candidates - i));
+		if (!found)
+			break;
+		const int offset = static_cast<int>(found - haystack);
+		if (memcmp(found + 1, needle + 1, lengthNeedle - 1) == 0)
+			return offset;
+		i = offset + 1;
+	}
+	return -1;
+}
+
+/**
+ * Returns the offset of the first of the length bytes of text which is
+ * non-ASCII or equal to a or b, or -1.
+ */
+static int FindNonAsciiOr(const char *text, int length, char a, char b) {
+	int i = 0;
+#ifdef SCI_SSE2_SEARCH
+	const __m128i blockA = _mm_set1_epi8(a);
+	const __m128i blockB = _mm_set1_epi8(b);
+	for (; i + 16 <= length; i += 16) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+		// Non-ASCII bytes have the high bit set just like matching bytes
+		const unsigned int mask = _mm_movemask_epi8(_mm_or_si128(block,
+			_mm_or_si128(_mm_cmpeq_epi8(block, blockA), _mm_cmpeq_epi8(block, blockB))));
+		if (mask)
+			return i + LowestBit(mask);
+	}
+#endif
+	for (; i < length; i++) {
+		if (!UTF8IsAscii(static_cast<unsigned char>(text[i])) || text[i] == a || text[i] == b)
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * Returns the first position in [pos, endPos) which is non-ASCII or holds a or b,
+ * or endPos. Each contiguous segment of the buffer is scanned in place.
+ */
+int Document::SkipAsciiExcept(int pos, int endPos, char a, char b) {
+	while (pos < endPos) {
+		const int segmentEnd = std::min(endPos, SegmentEnd(pos));
+		const char *segment = RangePointer(pos, segmentEnd - pos);
+		const int offset = FindNonAsciiOr(segment, segmentEnd - pos, a, b);
+		if (offset >= 0)
+			return pos + offset;
+		pos = segmentEnd;
+	}
+	return endPos;
+}
+
+/**
+ * Forward case sensitive search of the byte string search in [startPos, endPos).
+ * Each contiguous segment of the buffer is searched in place, only matches straddling
+ * the end of a segment are compared through CharAt.
+ */
+int Document::FindLiteralForward(int startPos, int endPos, const char *search, int lengthFind,
+	bool word, bool wordStart) {
+	const int endSearch = endPos - lengthFind + 1;
+	int pos = startPos;
+	while (pos < endSearch) {
+		const int segmentEnd = SegmentEnd(pos);
+
+		// Matches inside the segment
+		const int endInSegment = std::min(endSearch, segmentEnd - lengthFind + 1);
+		if (pos < endInSegment) {
+			const int segmentStart = pos;
+			const char *segment = RangePointer(segmentStart, segmentEnd - segmentStart);
+			while (pos < endInSegment) {
+				const int offset = FindLiteral(segment + pos - segmentStart, endInSegment - pos,
+					search, lengthFind);
+				if (offset < 0) {
+					pos = endInSegment;
+					break;
+				}
+				pos += offset;
+				if (MatchesWordOptions(word, wordStart, pos, lengthFind))
+					return pos;
+				pos++;
+			}
+		}
+
+		// Matches straddling the end of the segment
+		const int endStraddling = std::min(endSearch, segmentEnd);
+		for (; pos < endStraddling; pos++) {
+			bool found = true;
+			for (int indexSearch = 0; (indexSearch < lengthFind) && found; indexSearch++) {
+				found = CharAt(pos + indexSearch) == search[indexSearch];
+			}
+			if (found && MatchesWordOptions(word, wordStart, pos, lengthFind))
+				return pos;
+		}
+	}
+	return -1;
+}
+
 /**
  * Find text in document, supporting both forward and backward
  * searches (just pass minPos > maxPos to do a backward search)
@@ -1869,7 +2023,12 @@ long Document::FindText(int minPos, int maxPos, const char *search,
 			// Back all of a character
 			pos = NextPosition(pos, increment);
 		}
-		if (caseSensitive) {
+		if (caseSensitive && forward &&
+			(!dbcsCodePage || (SC_CP_UTF8 == dbcsCodePage && !UTF8IsTrailByte(static_cast<unsigned char>(search[0]))))) {
+			// Without DBCS, and in UTF-8 when search starts a character, every
+			// byte match is at a character start so bytes can be searched directly
+			return FindLiteralForward(pos, endPos, search, lengthFind, word, wordStart);
+		} else if (caseSensitive) {
 			const int endSearch = (startPos <= endPos) ? endPos - lengthFind + 1 : endPos;
 			const char charStartSearch =  search[0];
 			while (forward ? (pos < endSearch) : (pos >= endSearch)) {
@@ -1892,13 +2051,61 @@ long Document::FindText(int minPos, int maxPos, const char *search,
 				pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind));
 			char bytes[UTF8MaxBytes + 1];
 			char folded[UTF8MaxBytes * maxFoldingExpansion + 1];
+			// Fold ASCII characters through a table, -1 for those not folding to
+			// a single ASCII character
+			int asciiFolded[0x80];
+			bool asciiFoldsToAscii = true;
+			for (int ch = 0; ch < 0x80; ch++) {
+				const char chr = static_cast<char>(ch);
+				const size_t lenFlat = pcf->Fold(folded, sizeof(folded), &chr, 1);
+				asciiFolded[ch] = (lenFlat == 1 && UTF8IsAscii(static_cast<unsigned char>(folded[0]))) ? folded[0] : -1;
+				asciiFoldsToAscii = asciiFoldsToAscii && (asciiFolded[ch] >= 0);
+			}
+			// ASCII bytes which fold to the first search byte, a non-ASCII first
+			// byte can't be matched by any ASCII byte
+			char firstBytes[2] = { searchThing[0], searchThing[0] };
+			int countFirstBytes = 0;
+			if (UTF8IsAscii(static_cast<unsigned char>(searchThing[0]))) {
+				for (int ch = 0; ch < 0x80; ch++) {
+					if (asciiFolded[ch] == searchThing[0]) {
+						if (countFirstBytes < 2)
+							firstBytes[countFirstBytes] = static_cast<char>(ch);
+						countFirstBytes++;
+					}
+				}
+				if (countFirstBytes == 1)
+					firstBytes[1] = firstBytes[0];
+			}
+			// Positions starting with other ASCII characters are skipped without
+			// decoding or folding. Non-ASCII characters may fold to ASCII so they
+			// are always compared.
+			const bool skipAscii = forward && asciiFoldsToAscii && countFirstBytes <= 2;
 			while (forward ? (pos < endPos) : (pos >= endPos)) {
+				if (skipAscii) {
+					pos = SkipAsciiExcept(pos, endPos, firstBytes[0], firstBytes[1]);
+					if (pos >= endPos)
+						break;
+				}
 				int widthFirstCharacter = 0;
 				int posIndexDocument = pos;
 				int indexSearch = 0;
 				bool characterMatches = true;
 				for (;;) {
 					const unsigned char leadByte = static_cast<unsigned char>(cb.CharAt(posIndexDocument));
+					if (UTF8IsAscii(leadByte) && asciiFolded[leadByte] >= 0) {
+						if (!widthFirstCharacter)
+							widthFirstCharacter = 1;
+						if ((posIndexDocument + 1) > limitPos)
+							break;
+						characterMatches = asciiFolded[leadByte] == static_cast<unsigned char>(searchThing[indexSearch]);
+						if (!characterMatches)
+							break;
+						posIndexDocument++;
+						indexSearch++;
+						if (indexSearch >= lenSearch)
+							break;
+						continue;
+					}
 					bytes[0] = leadByte;
 					int widthChar = 1;
 					if (!UTF8IsAscii(leadByte)) {
@@ -2113,6 +2320,29 @@ void Document::StyleToAdjustingLineDuration(int pos) {
 	}
 }
 
+// Style [start, end) while the text before it is not styled yet, for showing an area far
+// after endStyled. The lexer starts a number of lines earlier, guessing that nothing open
+// there, such as a comment, continues from the unstyled text before.
+// endStyled does not move so the range is styled again in order later, which corrects the
+// styles and fold levels if the guess was wrong.
+void Document::StyleSpeculatively(int start, int end) {
+	const int linesBefore = 200;
+
+	const int lineEndStyled = LineFromPosition(GetEndStyled());
+	if ((enteredStyling != 0) || !pli || pli->UseContainerLexing() ||
+		(LineFromPosition(start) <= lineEndStyled) || (start >= end))
+		return;
+	if ((start >= startStyledSpeculative) && (end <= endStyledSpeculative))
+		return;
+	const int lineStart = std::max(LineFromPosition(start) - linesBefore, lineEndStyled + 1);
+	const int endStyledBefore = endStyled;
+	IncrementStyleClock();
+	pli->Colourise(LineStart(lineStart), end);
+	startStyledSpeculative = start;
+	endStyledSpeculative = std::max(endStyled, end);
+	endStyled = endStyledBefore;
+}
+
 void Document::LexerChanged() {
 	// Tell the watchers the lexer has changed.
 	for (std::vector<WatcherWithUserData>::iterator it = watchers.begin(); it != watchers.end(); ++it) {
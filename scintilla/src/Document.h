@@ -219,6 +219,9 @@ private:
 	CharClassify charClass;
 	CaseFolder *pcf;
 	int endStyled;
+	// Range styled ahead of endStyled by StyleSpeculatively
+	int startStyledSpeculative;
+	int endStyledSpeculative;
 	int styleClock;
 	int enteredModification;
 	int enteredStyling;
@@ -319,6 +322,9 @@ public:
 	bool CanUndo() const { return cb.CanUndo(); }
 	bool CanRedo() const { return cb.CanRedo(); }
 	void DeleteUndoHistory() { cb.DeleteUndoHistory(); }
+	void SetUndoMemoryLimit(size_t limit) { cb.SetUndoMemoryLimit(limit); }
+	size_t GetUndoMemoryLimit() const { return cb.GetUndoMemoryLimit(); }
+	int GetUndoDiscarded() const { return cb.GetUndoDiscarded(); }
 	bool SetUndoCollection(bool collectUndo) {
 		return cb.SetUndoCollection(collectUndo);
 	}
@@ -337,6 +343,7 @@ public:
 	const char * SCI_METHOD BufferPointer() { return cb.BufferPointer(); }
 	const char *RangePointer(int position, int rangeLength) { return cb.RangePointer(position, rangeLength); }
 	int GapPosition() const { return cb.GapPosition(); }
+	int SegmentEnd(int position) const { return cb.SegmentEnd(position); }
 
 	int SCI_METHOD GetLineIndentation(Sci_Position line);
 	int SetLineIndentation(int line, int indent);
@@ -402,6 +409,8 @@ public:
 	bool MatchesWordOptions(bool word, bool wordStart, int pos, int length) const;
 	bool HasCaseFolder() const;
 	void SetCaseFolder(CaseFolder *pcf_);
+	int SkipAsciiExcept(int pos, int endPos, char a, char b);
+	int FindLiteralForward(int startPos, int endPos, const char *search, int lengthFind, bool word, bool wordStart);
 	long FindText(int minPos, int maxPos, const char *search, int flags, int *length);
 	const char *SubstituteByPosition(const char *text, int *length);
 	int LinesTotal() const;
@@ -415,6 +424,7 @@ public:
 	int GetEndStyled() const { return endStyled; }
 	void EnsureStyledTo(int pos);
 	void StyleToAdjustingLineDuration(int pos);
+	void StyleSpeculatively(int start, int end);
 	void LexerChanged();
 	int GetStyleClock() const { return styleClock; }
 	void IncrementStyleClock();
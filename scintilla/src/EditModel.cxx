@@ -28,6 +28,7 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "BlockVector.h"
 #include "RunStyles.h"
 #include "ContractionState.h"
 #include "CellBuffer.h"
@@ -28,6 +28,7 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "BlockVector.h"
 #include "RunStyles.h"
 #include "ContractionState.h"
 #include "CellBuffer.h"
@@ -176,6 +177,7 @@ Editor::Editor() {
 	willRedrawAll = false;
 	idleStyling = SC_IDLESTYLING_NONE;
 	needIdleStyling = false;
+	durationWrapOneLine = 0.00001;
 
 	modEventMask = SC_MODEVENTMASKALL;
 
@@ -1474,7 +1476,7 @@ bool Editor::WrapOneLine(Surface *surface, int lineToWrap) {
 // Perform  wrapping for a subset of the lines needing wrapping.
 // wsAll: wrap all lines which need wrapping in this single call
 // wsVisible: wrap currently visible lines
-// wsIdle: wrap one page + 100 lines
+// wsIdle: wrap at least one page + 100 lines, more when that takes less than 20 milliseconds
 // Return true if wrapping occurred.
 bool Editor::WrapLines(enum wrapScope ws) {
 	int goodTopLine = topLine;
@@ -1488,7 +1490,10 @@ bool Editor::WrapLines(enum wrapScope ws) {
 			}
 			wrapOccurred = true;
 		}
+		const bool abandonedWrap = wrapPending.NeedsWrap();
 		wrapPending.Reset();
+		if (abandonedWrap)
+			NotifyWrapProgress();
 
 	} else if (wrapPending.NeedsWrap()) {
 		wrapPending.start = std::min(wrapPending.start, pdoc->LinesTotal());
@@ -1519,11 +1524,18 @@ bool Editor::WrapLines(enum wrapScope ws) {
 				return false;
 			}
 		} else if (ws == wsIdle) {
-			lineToWrapEnd = lineToWrap + LinesOnScreen() + 100;
+			// Wrapping large documents one page at a time spends most of the time on
+			// the idle calls and updating the scroll bars, so wrap for a time instead
+			const int linesToWrap = Platform::Clamp(static_cast<int>(0.02 / durationWrapOneLine),
+				LinesOnScreen() + 100, 0x10000);
+			lineToWrapEnd = lineToWrap + linesToWrap;
 		}
 		const int lineEndNeedWrap = std::min(wrapPending.end, pdoc->LinesTotal());
 		lineToWrapEnd = std::min(lineToWrapEnd, lineEndNeedWrap);
 
+		ElapsedTime etWrapping;
+		const int lineFirst = lineToWrap;
+
 		// Ensure all lines being wrapped are styled.
 		pdoc->EnsureStyledTo(pdoc->LineStart(lineToWrapEnd));
 
@@ -1550,9 +1562,21 @@ bool Editor::WrapLines(enum wrapScope ws) {
 			}
 		}
 
+		if ((ws == wsIdle) && (lineToWrap >= lineFirst + 8)) {
+			// Smooth the duration as for styling with bounds to avoid glitches
+			const double durationOneLine = etWrapping.Duration() / (lineToWrap - lineFirst);
+			durationWrapOneLine = 0.25 * durationOneLine + 0.75 * durationWrapOneLine;
+			if (durationWrapOneLine < 0.000001) {
+				durationWrapOneLine = 0.000001;
+			} else if (durationWrapOneLine > 0.001) {
+				durationWrapOneLine = 0.001;
+			}
+		}
+
 		// If wrapping is done, bring it to resting position
 		if (wrapPending.start >= lineEndNeedWrap) {
 			wrapPending.Reset();
+			NotifyWrapProgress();
 		}
 	}
 
@@ -2407,6 +2431,14 @@ void Editor::NotifyPainted() {
 	NotifyParent(scn);
 }
 
+// Report the first line still to be wrapped, or the number of lines when wrapping is done.
+void Editor::NotifyWrapProgress() {
+	SCNotification scn = {};
+	scn.nmhdr.code = SCN_WRAPPROGRESS;
+	scn.line = wrapPending.NeedsWrap() ? wrapPending.start : pdoc->LinesTotal();
+	NotifyParent(scn);
+}
+
 void Editor::NotifyIndicatorClick(bool click, int position, int modifiers) {
 	int mask = pdoc->decorations.AllOnFor(position);
 	if ((click && mask) || pdoc->decorations.clickNotified) {
@@ -4934,6 +4966,9 @@ bool Editor::Idle() {
 		WrapLines(wsIdle);
 		// No more wrapping
 		needWrap = wrapPending.NeedsWrap();
+		// Completion is reported by WrapLines
+		if (needWrap)
+			NotifyWrapProgress();
 	} else if (needIdleStyling) {
 		IdleStyling();
 	}
@@ -5087,6 +5122,11 @@ void Editor::StyleAreaBounded(PRectangle rcArea, bool scrolling) {
 		// Idle styling may be performed before current visible area
 		// Style a bit now then style further in idle time
 		pdoc->StyleToAdjustingLineDuration(posAfterMax);
+		// Rather than showing the area unstyled until idle styling reaches it, such as
+		// after jumping to the end of a large file, style it on its own now
+		const int lineArea = TopLineOfMain() + static_cast<int>(rcArea.top) / vs.lineHeight;
+		if (lineArea < cs.LinesDisplayed())
+			pdoc->StyleSpeculatively(pdoc->LineStart(cs.DocFromDisplay(lineArea)), posAfterArea);
 	} else {
 		// Can style all wanted now.
 		StyleToPositionInView(posAfterArea);
@@ -6167,6 +6207,16 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETUNDOCOLLECTION:
 		return pdoc->IsCollectingUndo();
 
+	case SCI_SETUNDOMEMORYLIMIT:
+		pdoc->SetUndoMemoryLimit(wParam);
+		return 0;
+
+	case SCI_GETUNDOMEMORYLIMIT:
+		return pdoc->GetUndoMemoryLimit();
+
+	case SCI_GETUNDODISCARDED:
+		return pdoc->GetUndoDiscarded();
+
 	case SCI_BEGINUNDOACTION:
 		pdoc->BeginUndoAction();
 		return 0;
@@ -6426,6 +6476,8 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		return pdoc->GetLineEndTypesActive();
 
 	case SCI_STARTSTYLING:
+		// Also drops text styled speculatively after the position
+		pdoc->ModifiedAt(static_cast<int>(wParam));
 		pdoc->StartStyling(static_cast<int>(wParam), static_cast<char>(lParam));
 		break;
 
@@ -7793,6 +7845,11 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETGAPPOSITION:
 		return pdoc->GapPosition();
 
+	case SCI_GETSEGMENTEND:
+		if (static_cast<int>(wParam) >= pdoc->Length())
+			return pdoc->Length();
+		return pdoc->SegmentEnd(static_cast<int>(wParam));
+
 	case SCI_SETEXTRAASCENT:
 		vs.extraAscent = static_cast<int>(wParam);
 		InvalidateStyleRedraw();
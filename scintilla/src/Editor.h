@@ -257,6 +257,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	// Wrapping support
 	WrapPending wrapPending;
+	double durationWrapOneLine;
 
 	bool convertPastes;
 
@@ -435,6 +436,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void NotifyHotSpotReleaseClick(int position, bool shift, bool ctrl, bool alt);
 	bool NotifyUpdateUI();
 	void NotifyPainted();
+	void NotifyWrapProgress();
 	void NotifyIndicatorClick(bool click, int position, int modifiers);
 	void NotifyIndicatorClick(bool click, int position, bool shift, bool ctrl, bool alt);
 	bool NotifyMarginClick(Point pt, int modifiers);
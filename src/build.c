@@ -745,7 +745,7 @@ static void build_spawn_cmd(GeanyDocument *doc, const gchar *cmd, const gchar *d
 	utf8_working_dir = !EMPTY(dir) ? g_strdup(dir) : g_path_get_dirname(doc->file_name);
 	working_dir = utils_get_locale_from_utf8(utf8_working_dir);
 
-	gtk_list_store_clear(msgwindow.store_compiler);
+	msgwin_clear_tab(MSG_COMPILER);
 	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_COMPILER);
 	msgwin_compiler_add(COLOR_BLUE, _("%s (in directory: %s)"), cmd, utf8_working_dir);
 	g_free(utf8_working_dir);
@@ -1417,6 +1417,7 @@ void build_menu_update(GeanyDocument *doc)
 		doc = document_get_current();
 	have_path = doc != NULL && doc->file_name != NULL;
 	build_running =  build_info.pid > (GPid) 1;
+	msgwin_flush_pending();
 	have_errors = gtk_tree_model_iter_n_children(GTK_TREE_MODEL(msgwindow.store_compiler), NULL) > 0;
 	for (i = 0; build_menu_specs[i].build_grp != MENU_DONE; ++i)
 	{
@@ -1625,6 +1626,7 @@ static void kill_process(GPid *pid)
 
 static void on_build_next_error(GtkWidget *menuitem, gpointer user_data)
 {
+	msgwin_flush_pending();
 	if (ui_tree_view_find_next(GTK_TREE_VIEW(msgwindow.tree_compiler),
 		msgwin_goto_compiler_file_line))
 	{
@@ -1637,6 +1639,7 @@ static void on_build_next_error(GtkWidget *menuitem, gpointer user_data)
 
 static void on_build_previous_error(GtkWidget *menuitem, gpointer user_data)
 {
+	msgwin_flush_pending();
 	if (ui_tree_view_find_previous(GTK_TREE_VIEW(msgwindow.tree_compiler),
 		msgwin_goto_compiler_file_line))
 	{
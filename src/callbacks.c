@@ -1313,6 +1313,7 @@ void on_menu_decrease_indent1_activate(GtkMenuItem *menuitem, gpointer user_data
 
 void on_next_message1_activate(GtkMenuItem *menuitem, gpointer user_data)
 {
+	msgwin_flush_pending();
 	if (! ui_tree_view_find_next(GTK_TREE_VIEW(msgwindow.tree_msg),
 		msgwin_goto_messages_file_line))
 		ui_set_statusbar(FALSE, _("No more message items."));
@@ -1321,6 +1322,7 @@ void on_next_message1_activate(GtkMenuItem *menuitem, gpointer user_data)
 
 void on_previous_message1_activate(GtkMenuItem *menuitem, gpointer user_data)
 {
+	msgwin_flush_pending();
 	if (! ui_tree_view_find_previous(GTK_TREE_VIEW(msgwindow.tree_msg),
 		msgwin_goto_messages_file_line))
 		ui_set_statusbar(FALSE, _("No more message items."));
@@ -1677,6 +1679,7 @@ static void on_search1_activate(GtkMenuItem *menuitem, gpointer user_data)
 	gboolean have_messages;
 
 	/* enable commands if the messages window has any items */
+	msgwin_flush_pending();
 	have_messages = gtk_tree_model_iter_n_children(GTK_TREE_MODEL(msgwindow.store_msg),
 		NULL) > 0;
 
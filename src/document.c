@@ -84,6 +84,18 @@
 
 #define USE_GIO_FILE_OPERATIONS (!file_prefs.use_safe_file_saving && file_prefs.use_gio_unsafe_file_saving)
 
+/* files of at least this size are mapped and converted chunk by chunk into Scintilla
+ * instead of being read and converted at once */
+#define LARGE_FILE_SIZE (64 * 1024 * 1024)
+/* bytes at the start of a large file used to detect its line endings */
+#define LARGE_FILE_EOL_SCAN_SIZE (1024 * 1024)
+
+/* when more type names change, whole documents are restyled instead of the
+ * lines using them */
+#define TYPENAME_RESTYLE_MAX_NAMES 32
+/* the lexer keyword set type names are added to, see document_highlight_tags() */
+#define TYPENAME_KEYWORD_IDX 3
+
 
 GeanyFilePrefs file_prefs;
 GPtrArray *documents_array = NULL;
@@ -114,6 +126,7 @@ static void document_undo_clear(GeanyDocument *doc);
 static void document_undo_add_internal(GeanyDocument *doc, guint type, gpointer data);
 static void document_redo_add(GeanyDocument *doc, guint type, gpointer data);
 static gboolean remove_page(guint page_num);
+static void release_typenames(GeanyDocument *doc);
 static GtkWidget* document_show_message(GeanyDocument *doc, GtkMessageType msgtype,
 	void (*response_cb)(GtkWidget *info_bar, gint response_id, GeanyDocument *doc),
 	const gchar *btn_1, GtkResponseType response_1,
@@ -710,6 +723,9 @@ static gboolean remove_page(guint page_num)
 	/* tell any plugins that the document is about to be closed */
 	g_signal_emit_by_name(geany_object, "document-close", doc);
 
+	/* the ScintillaWidget can outlive the document if something else references it */
+	release_typenames(doc);
+
 	/* Checking real_path makes it likely the file exists on disk */
 	if (! main_status.closing_all && doc->real_path != NULL)
 		ui_add_recent_document(doc);
@@ -921,6 +937,8 @@ typedef struct
 	gboolean	 bom;
 	time_t		 mtime;	/* modification time, read by stat::st_mtime */
 	gboolean	 readonly;
+	GMappedFile	*mapped;	/* contents of a large file instead of data, still to be converted */
+	guint		 bom_len;	/* length of the BOM at the start of mapped */
 } FileData;
 
 
@@ -973,6 +991,75 @@ static gboolean get_mtime(const gchar *locale_filename, time_t *time)
 }
 
 
+/* Maps a large local file and determines its encoding without reading it into memory.
+ * Returns FALSE if the file is small or has to be converted at once. */
+static gboolean load_mapped_file(const gchar *locale_filename, FileData *filedata,
+	const gchar *forced_enc)
+{
+	GMappedFile *mapped;
+	const gchar *contents;
+	gsize size;
+	GStatBuf st;
+
+	/* don't map small files only to find out their size */
+	if (utils_is_remote_path(locale_filename) || g_stat(locale_filename, &st) != 0 ||
+		st.st_size < LARGE_FILE_SIZE)
+		return FALSE;
+
+	mapped = g_mapped_file_new(locale_filename, FALSE, NULL);
+	if (mapped == NULL)
+		return FALSE;
+
+	contents = g_mapped_file_get_contents(mapped);
+	size = g_mapped_file_get_length(mapped);
+	/* the file may have changed since it was checked */
+	if (size < LARGE_FILE_SIZE ||
+		! encodings_detect_chunked(contents, size, forced_enc, &filedata->enc, &filedata->bom_len))
+	{
+		g_mapped_file_unref(mapped);
+		return FALSE;
+	}
+
+	filedata->mapped = mapped;
+	filedata->len = size;
+	filedata->bom = filedata->bom_len > 0;
+	return TRUE;
+}
+
+
+static void append_text_chunk(const gchar *text, gsize len, gpointer data)
+{
+	scintilla_send_message(data, SCI_APPENDTEXT, len, (sptr_t) text);
+}
+
+
+/* Converts the contents of a mapped large file into sci chunk by chunk, so that no full
+ * copy of it is made besides Scintilla's. Returns the detected line endings. */
+static gint set_text_from_mapped_file(ScintillaObject *sci, FileData *filedata)
+{
+	const gchar *contents = g_mapped_file_get_contents(filedata->mapped) + filedata->bom_len;
+	gsize size = filedata->len - filedata->bom_len;
+	gchar *head;
+	gint mode;
+
+	sci_start_undo_action(sci);
+	sci_set_text(sci, "");
+	scintilla_send_message(sci, SCI_ALLOCATE, size, 0);
+	/* the data was checked when it was mapped */
+	encodings_convert_to_utf8_chunked(contents, size, filedata->enc, append_text_chunk, sci);
+	sci_end_undo_action(sci);
+
+	g_mapped_file_unref(filedata->mapped);
+	filedata->mapped = NULL;
+
+	/* only look at the start of the file instead of copying it */
+	head = sci_get_contents_range(sci, 0, MIN(sci_get_length(sci), LARGE_FILE_EOL_SCAN_SIZE));
+	mode = utils_get_line_endings(head, strlen(head));
+	g_free(head);
+	return mode;
+}
+
+
 /* loads textfile data, verifies and converts to forced_enc or UTF-8. Also handles BOM. */
 static gboolean load_text_file(const gchar *locale_filename, const gchar *display_filename,
 	FileData *filedata, const gchar *forced_enc)
@@ -984,10 +1071,15 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 	filedata->enc = NULL;
 	filedata->bom = FALSE;
 	filedata->readonly = FALSE;
+	filedata->mapped = NULL;
+	filedata->bom_len = 0;
 
 	if (!get_mtime(locale_filename, &filedata->mtime))
 		return FALSE;
 
+	if (load_mapped_file(locale_filename, filedata, forced_enc))
+		return TRUE;
+
 	if (USE_GIO_FILE_OPERATIONS)
 	{
 		GFile *file = g_file_new_for_path(locale_filename);
@@ -1382,11 +1474,22 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 
 		/* add the text to the ScintillaObject */
 		sci_set_readonly(doc->editor->sci, FALSE);	/* to allow replacing text */
-		sci_set_text(doc->editor->sci, filedata.data);	/* NULL terminated data */
+		doc->priv->large_file = filedata.mapped != NULL;
+		/* style large files in idle time, the shown text is styled ahead when it is
+		 * far from the styled part */
+		scintilla_send_message(doc->editor->sci, SCI_SETIDLESTYLING,
+			doc->priv->large_file ? SC_IDLESTYLING_ALL : SC_IDLESTYLING_NONE, 0);
+		if (doc->priv->large_file)
+			editor_mode = set_text_from_mapped_file(doc->editor->sci, &filedata);
+		else
+		{
+			sci_set_text(doc->editor->sci, filedata.data);	/* NULL terminated data */
+			/* detect line endings */
+			editor_mode = utils_get_line_endings(filedata.data, filedata.len);
+		}
 		queue_colourise(doc);	/* Ensure the document gets colourised. */
 
-		/* detect & set line endings */
-		editor_mode = utils_get_line_endings(filedata.data, filedata.len);
+		/* set line endings */
 		if (undo_reload_data)
 		{
 			undo_reload_data->eol_mode = editor_get_eol_char_mode(doc->editor);
@@ -2635,20 +2738,10 @@ gint document_replace_all(GeanyDocument *doc, const gchar *find_text, const gcha
 }
 
 
-/*
- * Parses or re-parses the document's buffer and updates the type
- * keywords and symbol list.
- *
- * @param doc The document.
- */
-void document_update_tags(GeanyDocument *doc)
+/* Creates the TM source file if needed. Returns FALSE (after clearing the symbol
+ * list) when the document cannot be parsed. */
+static gboolean document_prepare_tags(GeanyDocument *doc)
 {
-	guchar *buffer_ptr;
-	gsize len;
-
-	g_return_if_fail(DOC_VALID(doc));
-	g_return_if_fail(app->tm_workspace != NULL);
-
 	/* early out if it's a new file or doesn't support tags */
 	if (! doc->file_name || ! doc->file_type || !filetype_has_tags(doc->file_type))
 	{
@@ -2656,7 +2749,7 @@ void document_update_tags(GeanyDocument *doc)
 		 * to ensure that the symbol list is always updated properly (e.g.
 		 * when creating a new document with a partial filename set. */
 		sidebar_update_tag_list(doc, FALSE);
-		return;
+		return FALSE;
 	}
 
 	/* create a new TM file if there isn't one yet */
@@ -2681,25 +2774,190 @@ void document_update_tags(GeanyDocument *doc)
 		 * to ensure that the symbol list is always updated properly (e.g.
 		 * when creating a new document with a partial filename set. */
 		sidebar_update_tag_list(doc, FALSE);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+/*
+ * Parses or re-parses the document's buffer and updates the type
+ * keywords and symbol list.
+ *
+ * @param doc The document.
+ */
+void document_update_tags(GeanyDocument *doc)
+{
+	guchar *buffer_ptr;
+	gsize len;
+	gboolean unmodified;
+
+	g_return_if_fail(DOC_VALID(doc));
+	g_return_if_fail(app->tm_workspace != NULL);
+
+	if (! document_prepare_tags(doc))
 		return;
+
+	/* the buffer of an unmodified UTF-8 document is identical to the file version it
+	 * was loaded from, so its tags can be taken from the tags cache if they were
+	 * cached for that version; they are only cached when parsed from the file though,
+	 * as the file may change after it was loaded */
+	unmodified = ! doc->changed && ! doc->has_bom && utils_str_equal(doc->encoding, "UTF-8");
+
+	if (! unmodified || ! tm_workspace_update_source_file_from_cache(doc->tm_file,
+			doc->priv->mtime, (gsize) sci_get_length(doc->editor->sci)))
+	{
+		/* Parse Scintilla's buffer directly using TagManager
+		 * Note: this buffer *MUST NOT* be modified */
+		len = sci_get_length(doc->editor->sci);
+		buffer_ptr = (guchar *) scintilla_send_message(doc->editor->sci, SCI_GETCHARACTERPOINTER, 0, 0);
+		tm_workspace_update_source_file_buffer(doc->tm_file, buffer_ptr, len);
 	}
 
-	/* Parse Scintilla's buffer directly using TagManager
-	 * Note: this buffer *MUST NOT* be modified */
-	len = sci_get_length(doc->editor->sci);
-	buffer_ptr = (guchar *) scintilla_send_message(doc->editor->sci, SCI_GETCHARACTERPOINTER, 0, 0);
-	tm_workspace_update_source_file_buffer(doc->tm_file, buffer_ptr, len);
+	sidebar_update_tag_list(doc, TRUE);
+	document_highlight_tags(doc);
+}
+
+
+/* Called from the main loop once the background parsing has finished and the
+ * new tags have been merged into the workspace. */
+static void on_document_tags_parsed(TMSourceFile *source_file, gpointer user_data)
+{
+	GeanyDocument *doc = user_data;
+
+	if (! DOC_VALID(doc) || doc->tm_file != source_file || main_status.quitting)
+		return;
 
 	sidebar_update_tag_list(doc, TRUE);
 	document_highlight_tags(doc);
 }
 
 
+/* Like document_update_tags() but parses a snapshot of the buffer in a worker
+ * thread so the UI isn't blocked while parsing big files. */
+static void document_update_tags_async(GeanyDocument *doc)
+{
+	gchar *buffer;
+	gsize len;
+
+	g_return_if_fail(app->tm_workspace != NULL);
+
+	if (! document_prepare_tags(doc))
+		return;
+
+	/* SCI_GETTEXT copies the text without moving the gap of the buffer */
+	len = sci_get_length(doc->editor->sci);
+	buffer = sci_get_contents(doc->editor->sci, len + 1);
+	tm_workspace_update_source_file_buffer_async(doc->tm_file, (guchar *) buffer, len,
+		on_document_tags_parsed, doc);
+}
+
+
+static gint compare_lines(gconstpointer a, gconstpointer b)
+{
+	return *(const gint *) a - *(const gint *) b;
+}
+
+
+/* Restyles the styled lines of doc which contain one of names */
+static void restyle_typename_lines(GeanyDocument *doc, GPtrArray *names)
+{
+	ScintillaObject *sci = doc->editor->sci;
+	gint end_styled = sci_get_end_styled(sci);
+	GArray *lines = g_array_new(FALSE, FALSE, sizeof(gint));
+	guint i;
+
+	for (i = 0; i < names->len; i++)
+	{
+		struct Sci_TextToFind ttf;
+
+		ttf.chrg.cpMin = 0;
+		ttf.chrg.cpMax = end_styled;
+		ttf.lpstrText = names->pdata[i];
+		while (ttf.chrg.cpMin < end_styled &&
+			sci_find_text(sci, SCFIND_MATCHCASE | SCFIND_WHOLEWORD, &ttf) != -1)
+		{
+			gint line = sci_get_line_from_position(sci, ttf.chrgText.cpMin);
+
+			g_array_append_val(lines, line);
+			ttf.chrg.cpMin = sci_get_position_from_line(sci, line + 1);
+			if (ttf.chrg.cpMin <= ttf.chrgText.cpMin)
+				break;	/* last line */
+		}
+	}
+
+	g_array_sort(lines, compare_lines);
+	for (i = 0; i < lines->len; i++)
+	{
+		gint line = g_array_index(lines, gint, i);
+
+		if (i > 0 && line == g_array_index(lines, gint, i - 1))
+			continue;
+		/* type names don't change the lexer state at the end of a line, so the
+		 * following lines don't need restyling */
+		sci_colourise(sci, sci_get_position_from_line(sci, line),
+			sci_get_line_end_position(sci, line));
+	}
+	/* restyling moved the end of the styled text back to the last line restyled */
+	if (lines->len > 0)
+		scintilla_send_message(sci, SCI_STARTSTYLING, end_styled, 0);
+	g_array_free(lines, TRUE);
+}
+
+
+/* Restyles the open documents with the type names of the workspace in a word
+ * set for the type names which were added or removed since the last call */
+static void apply_typename_changes(void)
+{
+	TMParserType lang;
+
+	for (lang = 0; lang < TM_PARSER_COUNT; lang++)
+	{
+		GPtrArray *names = tm_workspace_take_typename_changes(lang);
+		guint i;
+
+		if (names == NULL)
+			continue;
+
+		foreach_document(i)
+		{
+			GeanyDocument *doc = documents[i];
+
+			if (doc->priv->typenames == NULL ||
+				! tm_tag_langs_compatible(doc->file_type->lang, lang))
+				continue;
+
+			if (names->len > TYPENAME_RESTYLE_MAX_NAMES)
+				queue_colourise(doc);
+			else
+				restyle_typename_lines(doc, names);
+		}
+		g_ptr_array_unref(names);
+	}
+}
+
+
+/* Releases the document's type name set after making the lexer drop it. The lexer isn't
+ * recreated when the new filetype of a document uses the same one, so it could keep using
+ * the set otherwise. */
+static void release_typenames(GeanyDocument *doc)
+{
+	if (doc->priv->typenames == NULL)
+		return;
+
+	scintilla_send_message(doc->editor->sci, SCI_PRIVATELEXERCALL,
+		SC_LEXERCALL_SETWORDSET + TYPENAME_KEYWORD_IDX, 0);
+	symbols_typenames_unref(doc->priv->typenames);
+	doc->priv->typenames = NULL;
+}
+
+
 /* Re-highlights type keywords without re-parsing the whole document. */
 void document_highlight_tags(GeanyDocument *doc)
 {
 	GString *keywords_str;
 	gint keyword_idx;
+	gboolean had_typenames;
 
 	/* some filetypes support type keywords (such as struct names), but not
 	 * necessarily all filetypes for a particular scintilla lexer.  this
@@ -2721,15 +2979,35 @@ void document_highlight_tags(GeanyDocument *doc)
 			/* index of the keyword set in the Scintilla lexer, for
 			 * example in LexCPP.cxx, see "cppWordLists" global array.
 			 * TODO: this magic number should be a member of the filetype */
-			keyword_idx = 3;
+			keyword_idx = TYPENAME_KEYWORD_IDX;
 			break;
 		}
 		default:
+			/* the lexer may have been kept from a filetype supporting them */
+			release_typenames(doc);
 			return; /* early out if type keywords are not supported */
 	}
 	if (!app->tm_workspace->tags_array)
 		return;
 
+	/* lexers supporting it look the type names up in the workspace, then only the
+	 * lines using names which were added or removed need restyling */
+	had_typenames = doc->priv->typenames != NULL;
+	if (! had_typenames && doc->file_type->lang >= 0)
+		doc->priv->typenames = symbols_typenames_ref(doc->file_type->lang);
+	/* the lexer is recreated when the filetype changes, so always set the word set */
+	if (doc->priv->typenames != NULL &&
+		scintilla_send_message(doc->editor->sci, SCI_PRIVATELEXERCALL,
+			SC_LEXERCALL_SETWORDSET + keyword_idx, (sptr_t) doc->priv->typenames) != 0)
+	{
+		/* the text may have been styled without the type names */
+		if (! had_typenames)
+			queue_colourise(doc);
+		apply_typename_changes();
+		return;
+	}
+	release_typenames(doc);
+
 	/* get any type keywords and tell scintilla about them
 	 * this will cause the type keywords to be colourized in scintilla */
 	keywords_str = symbols_find_typenames_as_string(doc->file_type->lang, FALSE);
@@ -2757,7 +3035,7 @@ static gboolean on_document_update_tag_list_idle(gpointer data)
 		return FALSE;
 
 	if (! main_status.quitting)
-		document_update_tags(doc);
+		document_update_tags_async(doc);
 
 	doc->priv->tag_list_update_source = 0;
 
@@ -2775,6 +3053,10 @@ void document_update_tag_list_in_idle(GeanyDocument *doc)
 	if (doc->priv->tag_list_update_source != 0)
 		g_source_remove(doc->priv->tag_list_update_source);
 
+	/* tags of a snapshot being parsed in the background are outdated now */
+	if (doc->tm_file != NULL)
+		tm_workspace_cancel_source_file_update(doc->tm_file);
+
 	doc->priv->tag_list_update_source = g_timeout_add_full(G_PRIORITY_LOW,
 		editor_prefs.autocompletion_update_freq, on_document_update_tag_list_idle, doc, NULL);
 }
@@ -2801,6 +3083,8 @@ static void document_load_config(GeanyDocument *doc, GeanyFiletype *type,
 		/* load tags files before highlighting (some lexers highlight global typenames) */
 		if (type->id != GEANY_FILETYPES_NONE)
 			symbols_global_tags_loaded(type->id);
+		/* the type names may be of another language now */
+		release_typenames(doc);
 
 		highlighting_set_styles(doc->editor->sci, type);
 		editor_set_indentation_guides(doc->editor);
@@ -2812,7 +3096,10 @@ static void document_load_config(GeanyDocument *doc, GeanyFiletype *type,
 			doc->priv->symbol_list_sort_mode = type->priv->symbol_list_sort_mode;
 	}
 
-	document_update_tags(doc);
+	if (doc->priv->large_file)
+		document_update_tags_async(doc);
+	else
+		document_update_tags(doc);
 }
 
 
@@ -2895,21 +3182,19 @@ void document_set_encoding(GeanyDocument *doc, const gchar *new_encoding)
 /* Clears an Undo or Redo buffer. */
 void document_undo_clear_stack(GTrashStack **stack)
 {
-	while (g_trash_stack_height(stack) > 0)
-	{
-		undo_action *a = g_trash_stack_pop(stack);
+	undo_action *a;
 
-		if (G_LIKELY(a != NULL))
+	/* g_trash_stack_height() walks the whole stack, so just pop until it is empty */
+	while ((a = g_trash_stack_pop(stack)) != NULL)
+	{
+		switch (a->type)
 		{
-			switch (a->type)
-			{
-				case UNDO_ENCODING:
-				case UNDO_RELOAD:
-					g_free(a->data); break;
-				default: break;
-			}
-			g_free(a);
+			case UNDO_ENCODING:
+			case UNDO_RELOAD:
+				g_free(a->data); break;
+			default: break;
 		}
+		g_free(a);
 	}
 	*stack = NULL;
 }
@@ -2948,6 +3233,42 @@ void document_undo_add_internal(GeanyDocument *doc, guint type, gpointer data)
 	ui_update_popup_reundo_items(doc);
 }
 
+/* Drops the UNDO_SCINTILLA actions Scintilla discarded to stay within
+ * editor_private_prefs.undo_memory_limit, together with all older actions. */
+static void undo_drop_discarded(GeanyDocument *doc)
+{
+	gint discarded = (gint) scintilla_send_message(doc->editor->sci, SCI_GETUNDODISCARDED, 0, 0);
+	gint keep = 0;
+	GTrashStack *item;
+	undo_action *action;
+
+	if (discarded == doc->priv->undo_discarded)
+		return;
+
+	for (item = doc->priv->undo_actions; item != NULL; item = item->next)
+	{
+		if (((undo_action *) item)->type == UNDO_SCINTILLA)
+			keep++;
+	}
+	keep -= discarded - doc->priv->undo_discarded;
+	doc->priv->undo_discarded = discarded;
+
+	if (keep <= 0)
+	{
+		document_undo_clear_stack(&doc->priv->undo_actions);
+		return;
+	}
+	/* find the oldest UNDO_SCINTILLA action still in Scintilla's history */
+	for (item = doc->priv->undo_actions; ; item = item->next)
+	{
+		action = (undo_action *) item;
+		if (action->type == UNDO_SCINTILLA && --keep == 0)
+			break;
+	}
+	document_undo_clear_stack(&action->next);
+}
+
+
 /* note: this is called on SCN_MODIFIED notifications */
 void document_undo_add(GeanyDocument *doc, guint type, gpointer data)
 {
@@ -2955,17 +3276,23 @@ void document_undo_add(GeanyDocument *doc, guint type, gpointer data)
 	document_undo_clear_stack(&doc->priv->redo_actions);
 
 	document_undo_add_internal(doc, type, data);
+	undo_drop_discarded(doc);
 }
 
 
 gboolean document_can_undo(GeanyDocument *doc)
 {
+	undo_action *action;
+
 	g_return_val_if_fail(doc != NULL, FALSE);
 
-	if (g_trash_stack_height(&doc->priv->undo_actions) > 0 || sci_can_undo(doc->editor->sci))
+	/* Scintilla may also discard actions when it doesn't start a new one */
+	undo_drop_discarded(doc);
+	action = g_trash_stack_peek(&doc->priv->undo_actions);
+	if (action != NULL && action->type != UNDO_SCINTILLA)
 		return TRUE;
 	else
-		return FALSE;
+		return sci_can_undo(doc->editor->sci);
 }
 
 
@@ -2985,6 +3312,7 @@ void document_undo(GeanyDocument *doc)
 
 	g_return_if_fail(doc != NULL);
 
+	undo_drop_discarded(doc);
 	action = g_trash_stack_pop(&doc->priv->undo_actions);
 
 	if (G_UNLIKELY(action == NULL))
@@ -2999,6 +3327,13 @@ void document_undo(GeanyDocument *doc)
 		{
 			case UNDO_SCINTILLA:
 			{
+				if (! sci_can_undo(doc->editor->sci))
+				{
+					/* fallback, Scintilla's history should match the undo actions
+					 * after undo_drop_discarded() */
+					document_undo_clear_stack(&doc->priv->undo_actions);
+					break;
+				}
 				document_redo_add(doc, UNDO_SCINTILLA, NULL);
 
 				sci_undo(doc->editor->sci);
@@ -3081,7 +3416,7 @@ gboolean document_can_redo(GeanyDocument *doc)
 {
 	g_return_val_if_fail(doc != NULL, FALSE);
 
-	if (g_trash_stack_height(&doc->priv->redo_actions) > 0 || sci_can_redo(doc->editor->sci))
+	if (g_trash_stack_peek(&doc->priv->redo_actions) != NULL || sci_can_redo(doc->editor->sci))
 		return TRUE;
 	else
 		return FALSE;
@@ -88,10 +88,13 @@ typedef struct GeanyDocumentPrivate
 	GTrashStack		*undo_actions;
 	/* Used by the Undo/Redo management code. */
 	GTrashStack		*redo_actions;
+	/* Scintilla's SCI_GETUNDODISCARDED count the undo actions were last trimmed to. */
+	gint			 undo_discarded;
 	/* Used so Undo/Redo works for encoding changes. */
 	FileEncoding	 saved_encoding;
 	gboolean		 colourise_needed;	/* use document.c:queue_colourise() instead */
 	guint			 keyword_hash;	/* hash of keyword string used for typename colourisation */
+	Sci_WordSet		*typenames;		/* type names set in the lexer, see document_highlight_tags() */
 	gint			 line_count;		/* Number of lines in the document. */
 	gint			 symbol_list_sort_mode;
 	/* indicates whether a file is on a remote filesystem, works only with GIO/GVfs */
@@ -109,6 +112,8 @@ typedef struct GeanyDocumentPrivate
 	/* Whether it's temporarily protected (read-only and saving needs confirmation). Does
 	 * not imply doc->readonly as writable files can be protected */
 	gint			 protected;
+	/* Whether it was loaded as a large file, which is highlighted and parsed in the background */
+	gboolean		 large_file;
 	/* Save pointer to info bars allowing to cancel them programatically (to avoid multiple ones) */
 	GtkWidget		*info_bars[NUM_MSG_TYPES];
 	/* Keyed Data List to attach arbitrary data to the document */
@@ -56,6 +56,7 @@
 #include "templates.h"
 #include "ui_utils.h"
 #include "utils.h"
+#include "wordindex.h"
 
 #include "SciLexer.h"
 
@@ -84,6 +85,7 @@ static gchar current_word[GEANY_MAX_WORD_LENGTH];
 
 /* Initialised in keyfile.c. */
 GeanyEditorPrefs editor_prefs;
+EditorPrivatePrefs editor_private_prefs;
 
 EditorInfo editor_info = {current_word, -1};
 
@@ -511,6 +513,22 @@ static void on_margin_click(GeanyEditor *editor, SCNotification *nt)
 }
 
 
+/* wrapping fewer lines than this in idle time doesn't show progress */
+#define WRAP_PROGRESS_MIN_LINES	10000
+
+/* shows the progress of wrapping a long document in the statusbar, e.g. after enabling
+ * line wrapping, while Scintilla wraps the lines in idle time */
+static void on_wrap_progress(GeanyEditor *editor, SCNotification *nt)
+{
+	gint lines = sci_get_line_count(editor->sci);
+
+	if (nt->line >= lines || editor->document != document_get_current())
+		ui_progress_bar_release(editor);
+	else if (lines - nt->line >= WRAP_PROGRESS_MIN_LINES)
+		ui_progress_bar_set_fraction(editor, _("Wrapping lines"), nt->line / (gdouble) lines);
+}
+
+
 static void on_update_ui(GeanyEditor *editor, G_GNUC_UNUSED SCNotification *nt)
 {
 	ScintillaObject *sci = editor->sci;
@@ -601,7 +619,9 @@ static void check_line_breaking(GeanyEditor *editor, gint pos)
 }
 
 
-static void show_autocomplete(ScintillaObject *sci, gsize rootlen, GString *words)
+/* ranked lists are shown in their order and may contain words not starting
+ * with the typed text, the first word gets selected */
+static void show_autocomplete(ScintillaObject *sci, gsize rootlen, GString *words, gboolean ranked)
 {
 	/* hide autocompletion if only option is already typed */
 	if (rootlen >= words->len ||
@@ -612,11 +632,20 @@ static void show_autocomplete(ScintillaObject *sci, gsize rootlen, GString *word
 	}
 	/* store whether a calltip is showing, so we can reshow it after autocompletion */
 	calltip.set = (gboolean) SSM(sci, SCI_CALLTIPACTIVE, 0, 0);
+	SSM(sci, SCI_AUTOCSETORDER, ranked ? SC_ORDER_CUSTOM : SC_ORDER_PRESORTED, 0);
+	SSM(sci, SCI_AUTOCSETAUTOHIDE, !ranked, 0);
 	SSM(sci, SCI_AUTOCSHOW, rootlen, (sptr_t) words->str);
+	if (ranked && SSM(sci, SCI_AUTOCACTIVE, 0, 0))
+	{
+		gchar *first = g_strndup(words->str, strcspn(words->str, "?\n"));
+
+		SSM(sci, SCI_AUTOCSELECT, 0, (sptr_t) first);
+		g_free(first);
+	}
 }
 
 
-static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize rootlen)
+static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize rootlen, gboolean ranked)
 {
 	ScintillaObject *sci = editor->sci;
 
@@ -647,7 +676,7 @@ static void show_tags_list(GeanyEditor *editor, const GPtrArray *tags, gsize roo
 			else
 				g_string_append(words, "?1");
 		}
-		show_autocomplete(sci, rootlen, words);
+		show_autocomplete(sci, rootlen, words, ranked);
 		g_string_free(words, TRUE);
 	}
 }
@@ -798,7 +827,7 @@ static gboolean autocomplete_scope(GeanyEditor *editor, const gchar *root, gsize
 
 		if (filtered->len > 0)
 		{
-			show_tags_list(editor, filtered, rootlen);
+			show_tags_list(editor, filtered, rootlen, FALSE);
 			ret = TRUE;
 		}
 
@@ -1069,10 +1098,15 @@ void editor_sci_notify_cb(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED gint sc
 						  gpointer scnt, gpointer data)
 {
 	GeanyEditor *editor = data;
+	SCNotification *nt = scnt;
 	gboolean retval;
 
 	g_return_if_fail(editor != NULL);
 
+	/* update the word index before plugins can stop the signal */
+	if (nt->nmhdr.code == SCN_MODIFIED)
+		word_index_update(editor->sci, nt);
+
 	g_signal_emit_by_name(geany_object, "editor-notify", editor, scnt, &retval);
 }
 
@@ -1200,6 +1234,10 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 			/* recalculate line margin width */
 			sci_set_line_numbers(sci, editor_prefs.show_linenumber_margin);
 			break;
+
+		case SCN_WRAPPROGRESS:
+			on_wrap_progress(editor, nt);
+			break;
 	}
 	/* we always return FALSE here to let plugins handle the event too */
 	return FALSE;
@@ -2087,10 +2125,14 @@ autocomplete_tags(GeanyEditor *editor, GeanyFiletype *ft, const gchar *root, gsi
 
 	g_return_val_if_fail(editor, FALSE);
 
-	tags = tm_workspace_find_prefix(root, ft->lang, editor_prefs.autocompletion_max_entries);
+	if (editor_private_prefs.autocompletion_fuzzy)
+		tags = tm_workspace_find_fuzzy(root, ft->lang, editor->document->tm_file,
+			editor_prefs.autocompletion_max_entries);
+	else
+		tags = tm_workspace_find_prefix(root, ft->lang, editor_prefs.autocompletion_max_entries);
 	found = tags->len > 0;
 	if (found)
-		show_tags_list(editor, tags, rootlen);
+		show_tags_list(editor, tags, rootlen, editor_private_prefs.autocompletion_fuzzy);
 	g_ptr_array_free(tags, TRUE);
 
 	return found;
@@ -2133,59 +2175,12 @@ static gboolean autocomplete_check_html(GeanyEditor *editor, gint style, gint po
 }
 
 
-/* Algorithm based on based on Scite's StartAutoCompleteWord()
- * @returns a sorted list of words matching @p root */
+/* @returns a sorted list of words matching @p root */
 static GSList *get_doc_words(ScintillaObject *sci, gchar *root, gsize rootlen)
 {
-	gchar *word;
-	gint len, current, word_end;
-	gint pos_find, flags;
-	guint word_length;
-	gsize nmatches = 0;
-	GSList *words = NULL;
-	struct Sci_TextToFind ttf;
-
-	len = sci_get_length(sci);
-	current = sci_get_current_position(sci) - rootlen;
-
-	ttf.lpstrText = root;
-	ttf.chrg.cpMin = 0;
-	ttf.chrg.cpMax = len;
-	ttf.chrgText.cpMin = 0;
-	ttf.chrgText.cpMax = 0;
-	flags = SCFIND_WORDSTART | SCFIND_MATCHCASE;
-
-	/* search the whole document for the word root and collect results */
-	pos_find = scintilla_send_message(sci, SCI_FINDTEXT, flags, (uptr_t) &ttf);
-	while (pos_find >= 0 && pos_find < len)
-	{
-		word_end = pos_find + rootlen;
-		if (pos_find != current)
-		{
-			word_end = sci_word_end_position(sci, word_end, TRUE);
-
-			word_length = word_end - pos_find;
-			if (word_length > rootlen)
-			{
-				word = sci_get_contents_range(sci, pos_find, word_end);
-				/* search whether we already have the word in, otherwise add it */
-				if (g_slist_find_custom(words, word, (GCompareFunc)strcmp) != NULL)
-					g_free(word);
-				else
-				{
-					words = g_slist_prepend(words, word);
-					nmatches++;
-				}
-
-				if (nmatches == editor_prefs.autocompletion_max_entries)
-					break;
-			}
-		}
-		ttf.chrg.cpMin = word_end;
-		pos_find = scintilla_send_message(sci, SCI_FINDTEXT, flags, (uptr_t) &ttf);
-	}
-
-	return g_slist_sort(words, (GCompareFunc)utils_str_casecmp);
+	/* leave out the word being typed, unless it also occurs elsewhere */
+	return word_index_get_words(sci, root, sci_get_current_position(sci) - rootlen,
+		editor_prefs.autocompletion_max_entries);
 }
 
 
@@ -2217,7 +2212,7 @@ static gboolean autocomplete_doc_word(GeanyEditor *editor, gchar *root, gsize ro
 
 	g_slist_free(words);
 
-	show_autocomplete(sci, rootlen, str);
+	show_autocomplete(sci, rootlen, str, FALSE);
 	g_string_free(str, TRUE);
 	return TRUE;
 }
@@ -4763,7 +4758,14 @@ static gboolean editor_check_colourise(GeanyEditor *editor)
 		return FALSE;
 
 	doc->priv->colourise_needed = FALSE;
-	sci_colourise(editor->sci, 0, -1);
+	if (doc->priv->large_file)
+	{
+		/* restyle as the text gets drawn, the rest is styled in idle time */
+		SSM(editor->sci, SCI_STARTSTYLING, 0, 0);
+		gtk_widget_queue_draw(GTK_WIDGET(editor->sci));
+	}
+	else
+		sci_colourise(editor->sci, 0, -1);
 
 	/* now that the current document is colourised, fold points are now accurate,
 	 * so force an update of the current function/tag. */
@@ -4913,6 +4915,9 @@ static ScintillaObject *create_new_sci(GeanyEditor *editor)
 	/* Y policy is set in editor_apply_update_prefs() */
 	SSM(sci, SCI_AUTOCSETSEPARATOR, '\n', 0);
 	SSM(sci, SCI_SETSCROLLWIDTHTRACKING, 1, 0);
+	if (editor_private_prefs.undo_memory_limit > 0)
+		SSM(sci, SCI_SETUNDOMEMORYLIMIT,
+			(uptr_t) editor_private_prefs.undo_memory_limit * 1024 * 1024, 0);
 
 	/* tag autocompletion images */
 	register_named_icon(sci, 1, "classviewer-var");
@@ -5004,6 +5009,7 @@ GeanyEditor *editor_create(GeanyDocument *doc)
 /* in case we need to free some fields in future */
 void editor_destroy(GeanyEditor *editor)
 {
+	ui_progress_bar_release(editor);
 	g_free(editor);
 }
 
@@ -224,6 +224,16 @@ typedef struct
 
 extern EditorInfo editor_info;
 
+/* Editor settings not shown in the Prefs dialog and not part of the plugin API. */
+typedef struct EditorPrivatePrefs
+{
+	gboolean	autocompletion_fuzzy;
+	gint		undo_memory_limit;	/* in MiB, 0 for no limit */
+}
+EditorPrivatePrefs;
+
+extern EditorPrivatePrefs editor_private_prefs;
+
 
 void editor_init(void);
 
@@ -44,6 +44,7 @@
 #include "ui_utils.h"
 #include "utils.h"
 
+#include <errno.h>
 #include <string.h>
 
 
@@ -1084,3 +1085,124 @@ gboolean encodings_convert_to_utf8_auto(gchar **buf, gsize *size, const gchar *f
 	*buf = buffer.data;
 	return TRUE;
 }
+
+
+/* bytes converted at once by encodings_convert_to_utf8_chunked() */
+#define CONVERSION_CHUNK_SIZE (1024 * 1024)
+
+/*
+ * Converts @a buffer from @a charset to UTF-8 chunk by chunk, for data too large to be
+ * converted at once. UTF-8 and "None" data is passed to @a func in place.
+ *
+ * @param func function called with each converted chunk, or @c NULL to only check
+ *   that the data can be converted.
+ *
+ * @return @c TRUE if the conversion succeeded, @c FALSE if the data is invalid for
+ *   @a charset or contains a NUL byte.
+ */
+gboolean encodings_convert_to_utf8_chunked(const gchar *buffer, gsize size, const gchar *charset,
+		EncodingsChunkFunc func, gpointer user_data)
+{
+	GIConv conv;
+	gchar *inbuf = (gchar *) buffer;
+	gsize inbytes_left = size;
+	gchar *out;
+	gboolean success = TRUE;
+
+	if (utils_str_equal(charset, "UTF-8") ||
+		utils_str_equal(charset, encodings[GEANY_ENCODING_NONE].charset))
+	{
+		gboolean validate = utils_str_equal(charset, "UTF-8");
+
+		while (size > 0)
+		{
+			gsize len = MIN(size, CONVERSION_CHUNK_SIZE);
+			const gchar *end;
+
+			if (validate && ! g_utf8_validate(buffer, len, &end))
+			{
+				/* the last character might continue in the next chunk, otherwise the
+				 * next chunk starts with the invalid byte */
+				if (end == buffer || len == size)
+					return FALSE;
+				len = end - buffer;
+			}
+			else if (! validate && memchr(buffer, 0, len) != NULL)
+				return FALSE;
+
+			if (func)
+				func(buffer, len, user_data);
+			buffer += len;
+			size -= len;
+		}
+		return TRUE;
+	}
+
+	conv = g_iconv_open("UTF-8", charset);
+	if (conv == (GIConv) -1)
+		return FALSE;
+
+	out = g_malloc(CONVERSION_CHUNK_SIZE);
+	while (success && inbytes_left > 0)
+	{
+		gchar *outbuf = out;
+		gsize outbytes_left = CONVERSION_CHUNK_SIZE;
+
+		/* E2BIG only means that out is full */
+		if (g_iconv(conv, &inbuf, &inbytes_left, &outbuf, &outbytes_left) == (gsize) -1 &&
+			errno != E2BIG)
+			success = FALSE;
+		else if (memchr(out, 0, outbuf - out) != NULL)
+			success = FALSE;
+		else if (func && outbuf > out)
+			func(out, outbuf - out, user_data);
+	}
+	g_free(out);
+	g_iconv_close(conv);
+
+	return success;
+}
+
+
+/*
+ * Determines the encoding of @a buffer like encodings_convert_to_utf8_auto(), but without
+ * converting it, so that it can be converted with encodings_convert_to_utf8_chunked().
+ * Only the encodings given by @a forced_enc, a BOM or an encoding declaration, and
+ * otherwise UTF-8, are tried.
+ *
+ * @param used_encoding return location for the encoding.
+ * @param bom_len return location for the length of the BOM to skip before converting.
+ *
+ * @return @c TRUE if @a buffer can be converted chunk by chunk, @c FALSE if it needs
+ *   encodings_convert_to_utf8_auto().
+ */
+gboolean encodings_detect_chunked(const gchar *buffer, gsize size, const gchar *forced_enc,
+		gchar **used_encoding, guint *bom_len)
+{
+	GeanyEncodingIndex enc_idx = encodings_scan_unicode_bom(buffer, size, bom_len);
+	gchar *charset;
+
+	if (forced_enc != NULL)
+	{
+		/* only skip a BOM of the forced encoding */
+		if (enc_idx == GEANY_ENCODING_NONE || ! utils_str_equal(encodings[enc_idx].charset, forced_enc))
+			*bom_len = 0;
+		charset = g_strdup(forced_enc);
+	}
+	else if (enc_idx != GEANY_ENCODING_NONE)
+		charset = g_strdup(encodings[enc_idx].charset);
+	else
+	{
+		charset = encodings_check_regexes(buffer, size);
+		if (charset == NULL)
+			charset = g_strdup("UTF-8");
+	}
+
+	if (! encodings_convert_to_utf8_chunked(buffer + *bom_len, size - *bom_len, charset, NULL, NULL))
+	{
+		g_free(charset);
+		return FALSE;
+	}
+	*used_encoding = charset;
+	return TRUE;
+}
@@ -0,0 +1,748 @@
+/*
+ *      findinfiles.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Built-in Find in Files.
+ *
+ * Directories and files are searched by a thread pool: each directory task
+ * queues tasks for its files and subdirectories, so idle threads pick up
+ * whatever work is left. Files are memory mapped and searched as a whole,
+ * fixed strings with memchr()/memcmp() and regular expressions with GRegex,
+ * and only the lines containing a match are looked at. The output has grep's
+ * format and is added to the Messages tab in batches from the main loop.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "findinfiles.h"
+
+#include "msgwindow.h"
+#include "support.h"
+#include "ui_utils.h"
+#include "utils.h"
+
+#include "gtkcompat.h"
+
+#include <string.h>
+
+
+/* interval to add the found lines to the Messages tab, in milliseconds */
+#define FLUSH_INTERVAL	100
+/* grep treats files with a NUL byte in this many first bytes as binary */
+#define BINARY_CHECK_SIZE	32768
+
+
+typedef struct
+{
+	GPatternSpec *pattern;
+	gchar *base;		/* directory of the .gitignore, relative to the searched directory */
+	gboolean anchored;	/* the pattern contains a slash, match the path relative to base */
+	gboolean dir_only;
+}
+IgnoreRule;
+
+typedef struct
+{
+	/* read-only while searching */
+	GRegex *regex;
+	GRegex *raw_regex;		/* for files which aren't valid UTF-8 */
+	gchar *literal;			/* fixed string searched without regex, or NULL */
+	gsize literal_len;
+	gboolean whole_word;
+	gboolean invert;
+	gboolean recursive;
+	gchar *dir;				/* locale encoded */
+	GPtrArray *file_patterns;
+	const gchar *enc;
+
+	GThreadPool *pool;
+	gint pending;			/* queued tasks, accessed atomically */
+	gint cancelled;			/* accessed atomically */
+
+	GMutex lock;
+	GPtrArray *lines;		/* found lines not yet added to the Messages tab */
+	GPtrArray *errors;
+	GPtrArray *rules;		/* all ignore rules, freed with the search */
+	guint count;
+	guint flush_source;
+}
+FifSearch;
+
+typedef struct
+{
+	gchar *path;			/* relative to the searched directory */
+	gboolean is_dir;
+	GPtrArray *rules;		/* ignore rules applying to the directory */
+}
+FifTask;
+
+
+static FifSearch *current_search = NULL;
+
+/* directories of version control systems, never searched */
+static const gchar *vcs_dirs[] = { ".git", ".hg", ".svn", ".bzr", "CVS", NULL };
+
+
+static gboolean is_vcs_dir(const gchar *name)
+{
+	const gchar **dir;
+
+	for (dir = vcs_dirs; *dir; dir++)
+	{
+		if (strcmp(name, *dir) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static gboolean is_cancelled(FifSearch *search)
+{
+	return g_atomic_int_get(&search->cancelled);
+}
+
+
+static void ignore_rule_free(IgnoreRule *rule)
+{
+	g_pattern_spec_free(rule->pattern);
+	g_free(rule->base);
+	g_free(rule);
+}
+
+
+static void fif_search_free(FifSearch *search)
+{
+	if (search->regex)
+		g_regex_unref(search->regex);
+	if (search->raw_regex)
+		g_regex_unref(search->raw_regex);
+	g_free(search->literal);
+	g_free(search->dir);
+	g_ptr_array_free(search->file_patterns, TRUE);
+	g_ptr_array_free(search->lines, TRUE);
+	g_ptr_array_free(search->errors, TRUE);
+	g_ptr_array_free(search->rules, TRUE);
+	g_mutex_clear(&search->lock);
+	g_free(search);
+}
+
+
+static void queue_task(FifSearch *search, const gchar *path, gboolean is_dir, GPtrArray *rules)
+{
+	FifTask *task = g_new(FifTask, 1);
+
+	task->path = g_strdup(path);
+	task->is_dir = is_dir;
+	task->rules = rules ? g_ptr_array_ref(rules) : NULL;
+	g_atomic_int_inc(&search->pending);
+	g_thread_pool_push(search->pool, task, NULL);
+}
+
+
+static gchar *get_full_path(FifSearch *search, const gchar *path)
+{
+	return EMPTY(path) ? g_strdup(search->dir) : g_build_filename(search->dir, path, NULL);
+}
+
+
+/* Adds the rules of the .gitignore in path to a copy of parent_rules.
+ * Negated patterns aren't supported and ignored. */
+static GPtrArray *read_ignore_rules(FifSearch *search, const gchar *path, GPtrArray *parent_rules)
+{
+	GPtrArray *rules;
+	gchar *full_path, *filename, *contents;
+	gchar **lines, **line;
+
+	full_path = get_full_path(search, path);
+	filename = g_build_filename(full_path, ".gitignore", NULL);
+	g_free(full_path);
+	if (!g_file_get_contents(filename, &contents, NULL, NULL))
+	{
+		g_free(filename);
+		return parent_rules ? g_ptr_array_ref(parent_rules) : NULL;
+	}
+	g_free(filename);
+
+	rules = g_ptr_array_new();
+	if (parent_rules)
+	{
+		IgnoreRule *rule;
+		guint i;
+
+		foreach_ptr_array(rule, i, parent_rules)
+			g_ptr_array_add(rules, rule);
+	}
+
+	lines = g_strsplit_set(contents, "\r\n", -1);
+	foreach_strv(line, lines)
+	{
+		gchar *pattern = g_strstrip(*line);
+		IgnoreRule *rule;
+		gsize len;
+
+		if (*pattern == 0 || *pattern == '#' || *pattern == '!')
+			continue;
+
+		rule = g_new0(IgnoreRule, 1);
+		len = strlen(pattern);
+		if (len > 1 && pattern[len - 1] == '/')
+		{
+			rule->dir_only = TRUE;
+			pattern[len - 1] = 0;
+		}
+		rule->anchored = strchr(pattern, '/') != NULL;
+		if (*pattern == '/')
+			pattern++;
+		rule->pattern = g_pattern_spec_new(pattern);
+		rule->base = g_strdup(path);
+		g_ptr_array_add(rules, rule);
+
+		g_mutex_lock(&search->lock);
+		g_ptr_array_add(search->rules, rule);
+		g_mutex_unlock(&search->lock);
+	}
+	g_strfreev(lines);
+	g_free(contents);
+	return rules;
+}
+
+
+static const gchar *skip_dot_dir(const gchar *path)
+{
+	if (path[0] == '.' && path[1] == G_DIR_SEPARATOR)
+		return path + 2;
+	return path;
+}
+
+
+static gboolean is_ignored(GPtrArray *rules, const gchar *path, const gchar *name, gboolean is_dir)
+{
+	guint i;
+
+	for (i = 0; rules && i < rules->len; i++)
+	{
+		IgnoreRule *rule = rules->pdata[i];
+
+		if (rule->dir_only && !is_dir)
+			continue;
+		if (!rule->anchored)
+		{
+			if (g_pattern_match_string(rule->pattern, name))
+				return TRUE;
+		}
+		else
+		{
+			/* match the path relative to the directory containing the .gitignore */
+			const gchar *base = skip_dot_dir(rule->base);
+			const gchar *rel_path = skip_dot_dir(path);
+			gsize base_len = strlen(base);
+
+			if (base_len > 0)
+			{
+				if (strncmp(rel_path, base, base_len) != 0 || rel_path[base_len] != G_DIR_SEPARATOR)
+					continue;
+				rel_path += base_len + 1;
+			}
+			if (g_pattern_match_string(rule->pattern, rel_path))
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+static gboolean file_patterns_match(FifSearch *search, const gchar *name)
+{
+	guint i;
+
+	if (search->file_patterns->len == 0)
+		return TRUE;
+	for (i = 0; i < search->file_patterns->len; i++)
+	{
+		if (g_pattern_match_string(search->file_patterns->pdata[i], name))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static void add_error(FifSearch *search, GError *error)
+{
+	g_mutex_lock(&search->lock);
+	g_ptr_array_add(search->errors, g_strdup(error->message));
+	g_mutex_unlock(&search->lock);
+	g_error_free(error);
+}
+
+
+static void search_dir(FifSearch *search, FifTask *task)
+{
+	gchar *full_path = get_full_path(search, task->path);
+	GPtrArray *rules;
+	GError *error = NULL;
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open(full_path, 0, &error);
+	if (!dir)
+	{
+		add_error(search, error);
+		g_free(full_path);
+		return;
+	}
+
+	/* .gitignore files are only honoured when searching recursively */
+	rules = search->recursive ? read_ignore_rules(search, task->path, task->rules) : NULL;
+	while ((name = g_dir_read_name(dir)) != NULL && !is_cancelled(search))
+	{
+		gchar *entry_path = g_build_filename(full_path, name, NULL);
+		/* recursive output is relative to "." like grep -r . prints it */
+		gchar *rel_path = EMPTY(task->path) ?
+			(search->recursive ? g_strconcat(".", G_DIR_SEPARATOR_S, name, NULL) : g_strdup(name)) :
+			g_build_filename(task->path, name, NULL);
+		/* like grep -r, don't follow symlinks found while recursing */
+		gboolean is_link = search->recursive && g_file_test(entry_path, G_FILE_TEST_IS_SYMLINK);
+
+		if (g_file_test(entry_path, G_FILE_TEST_IS_DIR))
+		{
+			if (search->recursive && !is_link && !is_vcs_dir(name) &&
+				!is_ignored(rules, rel_path, name, TRUE))
+				queue_task(search, rel_path, TRUE, rules);
+		}
+		else if (!is_link && g_file_test(entry_path, G_FILE_TEST_IS_REGULAR) &&
+			file_patterns_match(search, name) &&
+			!is_ignored(rules, rel_path, name, FALSE))
+			queue_task(search, rel_path, FALSE, NULL);
+
+		g_free(rel_path);
+		g_free(entry_path);
+	}
+	g_dir_close(dir);
+	if (rules)
+		g_ptr_array_unref(rules);
+	g_free(full_path);
+}
+
+
+/* Returns the offset of the first line with a match from pos, and the end of the line */
+static gssize find_matching_line(FifSearch *search, GRegex *regex, const gchar *text, gsize len,
+		gsize pos, gsize *line_end)
+{
+	while (pos < len)
+	{
+		gsize start, end;
+		const gchar *eol;
+
+		if (search->literal)
+		{
+			const gchar *found = utils_find_bytes(text + pos, len - pos, search->literal, search->literal_len);
+
+			if (!found)
+				return -1;
+			start = found - text;
+			end = start + search->literal_len;
+		}
+		else
+		{
+			GMatchInfo *minfo;
+			gint match_start, match_end;
+
+			if (!g_regex_match_full(regex, text, len, pos, 0, &minfo, NULL))
+			{
+				g_match_info_free(minfo);
+				return -1;
+			}
+			g_match_info_fetch_pos(minfo, 0, &match_start, &match_end);
+			g_match_info_free(minfo);
+			start = match_start;
+			end = match_end;
+		}
+		/* an empty match after the last newline isn't on a line */
+		if (start >= len)
+			return -1;
+
+		/* pos is always a line start */
+		while (start > pos && text[start - 1] != '\n')
+			start--;
+		eol = memchr(text + start, '\n', len - start);
+		*line_end = eol ? (gsize) (eol - text) : len;
+
+		/* matches spanning lines and fixed strings which must be whole words are
+		 * checked against the line alone, grep only matches within lines */
+		if ((search->literal && !search->whole_word) ||
+			(!search->literal && end <= *line_end) ||
+			g_regex_match_full(regex, text + start, *line_end - start, 0, 0, NULL, NULL))
+			return start;
+
+		pos = *line_end + 1;
+	}
+	return -1;
+}
+
+
+static void add_line(FifSearch *search, GPtrArray *lines, const gchar *path, guint line_num,
+		const gchar *text, gsize len)
+{
+	gchar *line = g_strndup(text, len);
+	gchar *utf8_line = NULL;
+
+	/* enc is NULL when encoding is set to UTF-8, so we can skip any conversion */
+	if (!g_utf8_validate(line, -1, NULL))
+	{
+		utf8_line = g_convert(line, -1, "UTF-8", search->enc ? search->enc : "ISO-8859-1",
+			NULL, NULL, NULL);
+		if (utf8_line)
+			SETPTR(line, utf8_line);
+	}
+	utf8_line = g_strdup_printf("%s:%u:%s", path, line_num, line);
+	g_ptr_array_add(lines, g_strstrip(utf8_line));
+	g_free(line);
+}
+
+
+static guint count_lines(const gchar *text, gsize from, gsize to)
+{
+	guint count = 0;
+	const gchar *p = text + from;
+	const gchar *end = text + to;
+
+	while (p < end && (p = memchr(p, '\n', end - p)) != NULL)
+	{
+		count++;
+		p++;
+	}
+	return count;
+}
+
+
+static void search_file(FifSearch *search, FifTask *task)
+{
+	gchar *full_path = get_full_path(search, task->path);
+	GError *error = NULL;
+	GMappedFile *file = g_mapped_file_new(full_path, FALSE, &error);
+	const gchar *text;
+	gchar *utf8_path;
+	gsize len, pos = 0, line_end;
+	guint line_num = 1;		/* the number of the line at pos */
+	GPtrArray *lines;
+	GRegex *regex = search->regex;
+
+	g_free(full_path);
+	if (!file)
+	{
+		/* report files which can't be read like grep does */
+		add_error(search, error);
+		return;
+	}
+
+	text = g_mapped_file_get_contents(file);
+	len = g_mapped_file_get_length(file);
+	/* ignore binary files like grep -I */
+	if (len == 0 || memchr(text, 0, MIN(len, BINARY_CHECK_SIZE)))
+	{
+		g_mapped_file_unref(file);
+		return;
+	}
+	/* GRegex uses gint offsets, so it can't search beyond 2 GiB */
+	if (len > G_MAXINT && (!search->literal || search->whole_word))
+	{
+		utf8_path = utils_get_utf8_from_locale(task->path);
+		g_set_error(&error, G_FILE_ERROR, G_FILE_ERROR_FBIG,
+			_("%s: file too large for a regular expression search, skipped"), utf8_path);
+		add_error(search, error);
+		g_free(utf8_path);
+		g_mapped_file_unref(file);
+		return;
+	}
+	if (regex != search->raw_regex && !g_utf8_validate(text, len, NULL))
+		regex = search->raw_regex;
+
+	utf8_path = utils_get_utf8_from_locale(task->path);
+	lines = g_ptr_array_new();
+	while (pos < len && !is_cancelled(search))
+	{
+		gssize start = find_matching_line(search, regex, text, len, pos, &line_end);
+
+		if (start < 0)
+			break;
+
+		if (search->invert)
+		{
+			/* add the lines before the matching one, start is preceded by a newline */
+			while (pos < (gsize) start)
+			{
+				const gchar *eol = memchr(text + pos, '\n', start - pos);
+
+				add_line(search, lines, utf8_path, line_num++, text + pos, eol - (text + pos));
+				pos = eol - text + 1;
+			}
+		}
+		else
+		{
+			line_num += count_lines(text, pos, start);
+			add_line(search, lines, utf8_path, line_num, text + start, line_end - start);
+		}
+		pos = line_end + 1;
+		line_num++;
+	}
+	if (search->invert)
+	{
+		while (pos < len && !is_cancelled(search))
+		{
+			const gchar *eol = memchr(text + pos, '\n', len - pos);
+			gsize end = eol ? (gsize) (eol - text) : len;
+
+			add_line(search, lines, utf8_path, line_num++, text + pos, end - pos);
+			pos = end + 1;
+		}
+	}
+	g_mapped_file_unref(file);
+	g_free(utf8_path);
+
+	if (lines->len > 0)
+	{
+		guint i;
+
+		g_mutex_lock(&search->lock);
+		for (i = 0; i < lines->len; i++)
+			g_ptr_array_add(search->lines, lines->pdata[i]);
+		search->count += lines->len;
+		g_mutex_unlock(&search->lock);
+	}
+	g_ptr_array_free(lines, TRUE);
+}
+
+
+static void flush_lines(FifSearch *search)
+{
+	GPtrArray *lines, *errors;
+	guint i;
+
+	g_mutex_lock(&search->lock);
+	lines = search->lines;
+	errors = search->errors;
+	search->lines = g_ptr_array_new_with_free_func(g_free);
+	search->errors = g_ptr_array_new_with_free_func(g_free);
+	g_mutex_unlock(&search->lock);
+
+	for (i = 0; i < errors->len; i++)
+		msgwin_msg_add_string(COLOR_DARK_RED, -1, NULL, errors->pdata[i]);
+	for (i = 0; i < lines->len; i++)
+		msgwin_msg_add_string(COLOR_BLACK, -1, NULL, lines->pdata[i]);
+	g_ptr_array_free(lines, TRUE);
+	g_ptr_array_free(errors, TRUE);
+}
+
+
+static gboolean on_flush_timeout(gpointer data)
+{
+	flush_lines(data);
+	return TRUE;
+}
+
+
+static gboolean on_search_finished(gpointer data)
+{
+	FifSearch *search = data;
+
+	/* all tasks are done, this only waits for the threads to return */
+	g_thread_pool_free(search->pool, TRUE, TRUE);
+	if (search->flush_source)
+		g_source_remove(search->flush_source);
+
+	if (!is_cancelled(search))
+	{
+		flush_lines(search);
+		if (search->count > 0)
+		{
+			gchar *text = ngettext(
+						"Search completed with %d match.",
+						"Search completed with %d matches.", search->count);
+
+			msgwin_msg_add(COLOR_BLUE, -1, NULL, text, search->count);
+			ui_set_statusbar(FALSE, text, search->count);
+		}
+		else
+		{
+			const gchar *msg = _("No matches found.");
+
+			msgwin_msg_add_string(COLOR_BLUE, -1, NULL, msg);
+			ui_set_statusbar(FALSE, "%s", msg);
+		}
+		utils_beep();
+		ui_progress_bar_stop();
+		current_search = NULL;
+	}
+	fif_search_free(search);
+	return FALSE;
+}
+
+
+static void run_task(gpointer data, gpointer user_data)
+{
+	FifSearch *search = user_data;
+	FifTask *task = data;
+
+	if (!is_cancelled(search))
+	{
+		if (task->is_dir)
+			search_dir(search, task);
+		else
+			search_file(search, task);
+	}
+	if (task->rules)
+		g_ptr_array_unref(task->rules);
+	g_free(task->path);
+	g_free(task);
+
+	if (g_atomic_int_dec_and_test(&search->pending))
+		g_idle_add(on_search_finished, search);
+}
+
+
+static GRegex *compile_regex(const gchar *pattern, const FindInFilesOptions *options,
+		gboolean raw, GError **error)
+{
+	GRegexCompileFlags flags = G_REGEX_MULTILINE | G_REGEX_OPTIMIZE;
+	gchar *escaped = NULL;
+	gchar *word = NULL;
+	GRegex *regex;
+
+	if (!options->case_sensitive)
+		flags |= G_REGEX_CASELESS;
+	if (raw)
+		flags |= G_REGEX_RAW;
+	if (!options->regexp)
+		pattern = escaped = g_regex_escape_string(pattern, -1);
+	if (options->whole_word)
+		pattern = word = g_strconcat("\\b(?:", pattern, ")\\b", NULL);
+
+	regex = g_regex_new(pattern, flags, 0, error);
+	g_free(escaped);
+	g_free(word);
+	return regex;
+}
+
+
+/* Searches the files in utf8_dir, adding the lines found to the Messages tab.
+ * enc is the encoding of the files, NULL for UTF-8. Returns FALSE if the search
+ * couldn't be started. */
+gboolean find_in_files_start(const gchar *utf8_search_text, const gchar *utf8_dir,
+		const gchar *enc, const FindInFilesOptions *options)
+{
+	FifSearch *search;
+	gchar *search_text = NULL;
+	gchar *utf8_str;
+	GError *error = NULL;
+	gchar **pattern;
+
+	g_return_val_if_fail(!EMPTY(utf8_search_text) && utf8_dir != NULL, FALSE);
+
+	/* convert the search text in the preferred encoding (if the text is not valid UTF-8. assume
+	 * it is already in the preferred encoding) */
+	if (enc != NULL && g_utf8_validate(utf8_search_text, -1, NULL))
+		search_text = g_convert(utf8_search_text, -1, enc, "UTF-8", NULL, NULL, NULL);
+	if (search_text == NULL)
+		search_text = g_strdup(utf8_search_text);
+
+	search = g_new0(FifSearch, 1);
+	/* files in other encodings are matched bytewise */
+	search->raw_regex = compile_regex(search_text, options, TRUE, &error);
+	if (search->raw_regex && enc == NULL)
+		search->regex = compile_regex(search_text, options, FALSE, &error);
+	else if (search->raw_regex)
+		search->regex = g_regex_ref(search->raw_regex);
+	if (!search->regex)
+	{
+		ui_set_statusbar(FALSE, _("Bad regex: %s"), error->message);
+		g_error_free(error);
+		if (search->raw_regex)
+			g_regex_unref(search->raw_regex);
+		g_free(search);
+		g_free(search_text);
+		return FALSE;
+	}
+
+	/* case sensitive fixed strings don't need the regex to find the lines */
+	if (!options->regexp && options->case_sensitive)
+	{
+		search->literal = search_text;
+		search->literal_len = strlen(search_text);
+	}
+	else
+		g_free(search_text);
+	search->whole_word = options->whole_word;
+	search->invert = options->invert;
+	search->recursive = options->recursive;
+	search->dir = utils_get_locale_from_utf8(utf8_dir);
+	search->enc = enc;
+	search->file_patterns = g_ptr_array_new_with_free_func((GDestroyNotify) g_pattern_spec_free);
+	foreach_strv(pattern, options->file_patterns)
+	{
+		if (!EMPTY(*pattern))
+			g_ptr_array_add(search->file_patterns, g_pattern_spec_new(*pattern));
+	}
+	g_mutex_init(&search->lock);
+	search->lines = g_ptr_array_new_with_free_func(g_free);
+	search->errors = g_ptr_array_new_with_free_func(g_free);
+	search->rules = g_ptr_array_new_with_free_func((GDestroyNotify) ignore_rule_free);
+
+	if (!g_file_test(search->dir, G_FILE_TEST_IS_DIR))
+	{
+		ui_set_statusbar(TRUE, _("Could not open directory (%s)"), utf8_dir);
+		fif_search_free(search);
+		return FALSE;
+	}
+
+	find_in_files_cancel();
+	current_search = search;
+
+	msgwin_clear_tab(MSG_MESSAGE);
+	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_MESSAGE);
+	ui_progress_bar_start(_("Searching..."));
+	msgwin_set_messages_dir(search->dir);
+	utf8_str = g_strdup_printf(_("Searching for \"%s\" (in directory: %s)"),
+		utf8_search_text, utf8_dir);
+	msgwin_msg_add_string(COLOR_BLUE, -1, NULL, utf8_str);
+	g_free(utf8_str);
+
+	search->pool = g_thread_pool_new(run_task, search, utils_get_thread_count(), FALSE, NULL);
+	search->flush_source = g_timeout_add(FLUSH_INTERVAL, on_flush_timeout, search);
+	queue_task(search, "", TRUE, NULL);
+	return TRUE;
+}
+
+
+/* Stops the running search, its results are discarded */
+void find_in_files_cancel(void)
+{
+	if (!current_search)
+		return;
+
+	g_atomic_int_set(&current_search->cancelled, TRUE);
+	if (current_search->flush_source)
+		g_source_remove(current_search->flush_source);
+	current_search->flush_source = 0;
+	ui_progress_bar_stop();
+	/* the search is freed when its remaining tasks have returned */
+	current_search = NULL;
+}
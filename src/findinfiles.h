@@ -0,0 +1,48 @@
+/*
+ *      findinfiles.h - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef GEANY_FINDINFILES_H
+#define GEANY_FINDINFILES_H 1
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct FindInFilesOptions
+{
+	gboolean	regexp;			/* search_text is an extended regular expression */
+	gboolean	case_sensitive;
+	gboolean	whole_word;
+	gboolean	invert;			/* report the lines not matching */
+	gboolean	recursive;
+	gchar		**file_patterns;	/* only search files matching one of these, NULL for all */
+}
+FindInFilesOptions;
+
+
+gboolean find_in_files_start(const gchar *utf8_search_text, const gchar *utf8_dir,
+		const gchar *enc, const FindInFilesOptions *options);
+
+void find_in_files_cancel(void);
+
+G_END_DECLS
+
+#endif /* GEANY_FINDINFILES_H */
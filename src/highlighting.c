@@ -42,6 +42,7 @@
 #include "symbols.h"
 #include "ui_utils.h"
 #include "utils.h"
+#include "wordindex.h"
 
 #include "SciLexer.h"
 
@@ -595,6 +596,8 @@ static void set_character_classes(ScintillaObject *sci, guint ft_id)
 	guint i, j;
 
 	SSM(sci, SCI_SETWORDCHARS, 0, (sptr_t) word);
+	/* the indexed words depend on the word characters */
+	word_index_invalidate(sci);
 
 	/* setting wordchars resets character classes, so we have to set whitespaces after
 	 * wordchars, but we want wordchars to have precenence over whitepace chars */
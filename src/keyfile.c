@@ -236,6 +236,10 @@ static void init_pref_groups(void)
 		"use_gtk_word_boundaries", TRUE);
 	stash_group_add_boolean(group, &editor_prefs.complete_snippets_whilst_editing,
 		"complete_snippets_whilst_editing", FALSE);
+	stash_group_add_boolean(group, &editor_private_prefs.autocompletion_fuzzy,
+		"autocompletion_fuzzy", FALSE);
+	stash_group_add_integer(group, &editor_private_prefs.undo_memory_limit,
+		"undo_memory_limit", 0);
 	stash_group_add_boolean(group, &file_prefs.use_safe_file_saving,
 		atomic_file_saving_key, FALSE);
 	stash_group_add_boolean(group, &file_prefs.gio_unsafe_save_backup,
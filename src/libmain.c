@@ -105,6 +105,7 @@ static gchar *lib_vte = NULL;
 #endif
 static gboolean generate_tags = FALSE;
 static gboolean no_preprocessing = FALSE;
+static gboolean binary_tags = FALSE;
 static gboolean ft_names = FALSE;
 static gboolean print_prefix = FALSE;
 #ifdef HAVE_PLUGINS
@@ -115,6 +116,7 @@ static gboolean dummy = FALSE;
 /* in alphabetical order of short options */
 static GOptionEntry entries[] =
 {
+	{ "binary-tags", 0, 0, G_OPTION_ARG_NONE, &binary_tags, N_("Write the generated tags file in the binary format"), NULL },
 	{ "column", 0, 0, G_OPTION_ARG_INT, &cl_options.goto_column, N_("Set initial column number for the first opened file (useful in conjunction with --line)"), NULL },
 	{ "config", 'c', 0, G_OPTION_ARG_FILENAME, &alternate_config, N_("Use an alternate configuration directory"), NULL },
 	{ "ft-names", 0, 0, G_OPTION_ARG_NONE, &ft_names, N_("Print internal filetype names"), NULL },
@@ -590,7 +592,7 @@ static void parse_command_line_options(gint *argc, gchar ***argv)
 		gboolean ret;
 
 		filetypes_init_types();
-		ret = symbols_generate_global_tags(*argc, *argv, ! no_preprocessing);
+		ret = symbols_generate_global_tags(*argc, *argv, ! no_preprocessing, binary_tags);
 		filetypes_free_types();
 		wait_for_input_on_windows();
 		exit(ret);
@@ -1148,6 +1150,7 @@ gint main_lib(gint argc, gchar **argv)
 	navqueue_init();
 	document_init_doclist();
 	symbols_init();
+	project_index_init();
 	editor_snippets_init();
 
 #ifdef HAVE_VTE
@@ -1275,6 +1278,7 @@ static void do_main_quit(void)
 	search_finalize();
 	build_finalize();
 	document_finalize();
+	project_index_finalize();
 	symbols_finalize();
 	project_finalize();
 	editor_finalize();
@@ -82,6 +82,25 @@ enum
 	COMPILER_COL_COUNT
 };
 
+/* interval to add pending rows to the compiler and messages tabs, in milliseconds */
+#define FLUSH_INTERVAL	40
+
+/* a row not yet added to the compiler or messages tab */
+typedef struct
+{
+	gint color;
+	gint line;
+	guint doc_id;
+	gchar *string;
+}
+PendingRow;
+
+/* rows are added in batches, so long build or search output doesn't update the
+ * views for every line */
+static GPtrArray *pending_compiler = NULL;
+static GPtrArray *pending_msg = NULL;
+static guint flush_source = 0;
+
 
 static void prepare_msg_tree_view(void);
 static void prepare_status_tree_view(void);
@@ -92,6 +111,15 @@ static gboolean on_msgwin_button_press_event(GtkWidget *widget, GdkEventButton *
 static void on_scribble_populate(GtkTextView *textview, GtkMenu *arg1, gpointer user_data);
 
 
+static void pending_row_free(gpointer data)
+{
+	PendingRow *row = data;
+
+	g_free(row->string);
+	g_slice_free(PendingRow, row);
+}
+
+
 void msgwin_show_hide_tabs(void)
 {
 	ui_widget_show_hide(gtk_widget_get_parent(msgwindow.tree_status), interface_prefs.msgwin_status_visible);
@@ -121,6 +149,9 @@ void msgwin_init(void)
 	msgwindow.scribble = ui_lookup_widget(main_widgets.window, "textview_scribble");
 	msgwindow.messages_dir = NULL;
 
+	pending_compiler = g_ptr_array_new_with_free_func(pending_row_free);
+	pending_msg = g_ptr_array_new_with_free_func(pending_row_free);
+
 	prepare_status_tree_view();
 	prepare_msg_tree_view();
 	prepare_compiler_tree_view();
@@ -135,6 +166,10 @@ void msgwin_init(void)
 
 void msgwin_finalize(void)
 {
+	if (flush_source)
+		g_source_remove(flush_source);
+	g_ptr_array_free(pending_compiler, TRUE);
+	g_ptr_array_free(pending_msg, TRUE);
 	g_free(msgwindow.messages_dir);
 }
 
@@ -301,20 +336,47 @@ void msgwin_compiler_add(gint msg_color, const gchar *format, ...)
 }
 
 
-void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
+/* Removes the first rows of store so that at most ui_prefs.msgwin_max_lines rows are left
+ * after adding n_new rows. Returns the number of new rows to skip if there are too many. */
+static guint limit_rows(GtkListStore *store, guint n_new)
 {
+	GtkTreeModel *model = GTK_TREE_MODEL(store);
 	GtkTreeIter iter;
-	const GdkColor *color = get_color(msg_color);
-	gchar *utf8_msg;
+	guint max_lines, n_rows, n_remove;
 
-	if (! g_utf8_validate(msg, -1, NULL))
-		utf8_msg = utils_get_utf8_from_locale(msg);
-	else
-		utf8_msg = (gchar *) msg;
+	if (ui_prefs.msgwin_max_lines <= 0)
+		return 0;
+	max_lines = ui_prefs.msgwin_max_lines;
+	if (n_new >= max_lines)
+	{
+		gtk_list_store_clear(store);
+		return n_new - max_lines;
+	}
+
+	n_rows = gtk_tree_model_iter_n_children(model, NULL);
+	n_remove = n_rows + n_new > max_lines ? n_rows + n_new - max_lines : 0;
+	while (n_remove-- > 0 && gtk_tree_model_get_iter_first(model, &iter))
+		gtk_list_store_remove(store, &iter);
+	return 0;
+}
+
+
+static void flush_compiler_rows(void)
+{
+	GtkTreeIter iter;
+	guint i;
+
+	if (pending_compiler->len == 0)
+		return;
 
-	gtk_list_store_append(msgwindow.store_compiler, &iter);
-	gtk_list_store_set(msgwindow.store_compiler, &iter,
-		COMPILER_COL_COLOR, color, COMPILER_COL_STRING, utf8_msg, -1);
+	for (i = limit_rows(msgwindow.store_compiler, pending_compiler->len); i < pending_compiler->len; i++)
+	{
+		PendingRow *row = pending_compiler->pdata[i];
+
+		gtk_list_store_insert_with_values(msgwindow.store_compiler, &iter, -1,
+			COMPILER_COL_COLOR, get_color(row->color), COMPILER_COL_STRING, row->string, -1);
+	}
+	g_ptr_array_set_size(pending_compiler, 0);
 
 	if (ui_prefs.msgwindow_visible && interface_prefs.compiler_tab_autoscroll)
 	{
@@ -325,12 +387,79 @@ void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
 		gtk_tree_path_free(path);
 	}
 
-	/* calling build_menu_update for every build message would be overkill, TODO really should call it once when all done */
+	/* calling build_menu_update for every batch would be overkill */
 	gtk_widget_set_sensitive(build_get_menu_items(-1)->menu_item[GBG_FIXED][GBF_NEXT_ERROR], TRUE);
 	gtk_widget_set_sensitive(build_get_menu_items(-1)->menu_item[GBG_FIXED][GBF_PREV_ERROR], TRUE);
+}
+
 
-	if (utf8_msg != msg)
-		g_free(utf8_msg);
+static void flush_msg_rows(void)
+{
+	GtkTreeIter iter;
+	guint i;
+
+	if (pending_msg->len == 0)
+		return;
+
+	for (i = limit_rows(msgwindow.store_msg, pending_msg->len); i < pending_msg->len; i++)
+	{
+		PendingRow *row = pending_msg->pdata[i];
+
+		gtk_list_store_insert_with_values(msgwindow.store_msg, &iter, -1,
+			MSG_COL_LINE, row->line, MSG_COL_DOC_ID, row->doc_id,
+			MSG_COL_COLOR, get_color(row->color), MSG_COL_STRING, row->string, -1);
+	}
+	g_ptr_array_set_size(pending_msg, 0);
+}
+
+
+/* Adds the rows waiting to be shown to the compiler and messages tabs. This has to be
+ * called before reading their list stores. */
+void msgwin_flush_pending(void)
+{
+	if (flush_source)
+	{
+		g_source_remove(flush_source);
+		flush_source = 0;
+	}
+	flush_compiler_rows();
+	flush_msg_rows();
+}
+
+
+static gboolean on_flush_timeout(gpointer data)
+{
+	flush_source = 0;
+	msgwin_flush_pending();
+	return FALSE;
+}
+
+
+static void add_pending_row(GPtrArray *rows, gint msg_color, gint line, guint doc_id, gchar *string)
+{
+	PendingRow *row = g_slice_new(PendingRow);
+
+	row->color = msg_color;
+	row->line = line;
+	row->doc_id = doc_id;
+	row->string = string;
+	g_ptr_array_add(rows, row);
+
+	if (!flush_source)
+		flush_source = g_timeout_add(FLUSH_INTERVAL, on_flush_timeout, NULL);
+}
+
+
+void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
+{
+	gchar *utf8_msg;
+
+	if (! g_utf8_validate(msg, -1, NULL))
+		utf8_msg = utils_get_utf8_from_locale(msg);
+	else
+		utf8_msg = g_strdup(msg);
+
+	add_pending_row(pending_compiler, msg_color, -1, 0, utf8_msg);
 }
 
 
@@ -379,8 +508,6 @@ void msgwin_msg_add(gint msg_color, gint line, GeanyDocument *doc, const gchar *
 /* adds string to the msg treeview */
 void msgwin_msg_add_string(gint msg_color, gint line, GeanyDocument *doc, const gchar *string)
 {
-	GtkTreeIter iter;
-	const GdkColor *color = get_color(msg_color);
 	gchar *tmp;
 	gsize len;
 	gchar *utf8_msg;
@@ -398,18 +525,14 @@ void msgwin_msg_add_string(gint msg_color, gint line, GeanyDocument *doc, const
 		tmp = g_strdup(string);
 
 	if (! g_utf8_validate(tmp, -1, NULL))
+	{
 		utf8_msg = utils_get_utf8_from_locale(tmp);
+		g_free(tmp);
+	}
 	else
 		utf8_msg = tmp;
 
-	gtk_list_store_append(msgwindow.store_msg, &iter);
-	gtk_list_store_set(msgwindow.store_msg, &iter,
-		MSG_COL_LINE, line, MSG_COL_DOC_ID, doc ? doc->id : 0, MSG_COL_COLOR,
-		color, MSG_COL_STRING, utf8_msg, -1);
-
-	g_free(tmp);
-	if (utf8_msg != tmp)
-		g_free(utf8_msg);
+	add_pending_row(pending_msg, msg_color, line, doc ? doc->id : 0, utf8_msg);
 }
 
 
@@ -514,6 +637,7 @@ static void on_compiler_treeview_copy_all_activate(GtkMenuItem *menuitem, gpoint
 	gint str_idx = COMPILER_COL_STRING;
 	gboolean valid;
 
+	msgwin_flush_pending();
 	switch (GPOINTER_TO_INT(user_data))
 	{
 		case MSG_STATUS:
@@ -1255,10 +1379,12 @@ void msgwin_clear_tab(gint tabnum)
 	switch (tabnum)
 	{
 		case MSG_MESSAGE:
+			g_ptr_array_set_size(pending_msg, 0);
 			store = msgwindow.store_msg;
 			break;
 
 		case MSG_COMPILER:
+			g_ptr_array_set_size(pending_compiler, 0);
 			gtk_list_store_clear(msgwindow.store_compiler);
 			build_menu_update(NULL);	/* update next error items */
 			return;
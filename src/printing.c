@@ -344,6 +344,7 @@ static void begin_print(GtkPrintOperation *operation, GtkPrintContext *context,
 	if (dinfo == NULL)
 		return;
 
+	ui_progress_bar_take();
 	gtk_widget_show(main_widgets.progressbar);
 
 	/* init dinfo fields */
@@ -0,0 +1,708 @@
+/*
+ *      projectindex.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Background indexing of the project files which aren't open.
+ *
+ * A worker thread crawls the project base directory, parses the files with a
+ * known filetype and hands them over to the main thread in batches, which adds
+ * them to the tagmanager workspace so that autocompletion, calltips and symbol
+ * lookup see the whole project. The worker waits until each batch was added, so
+ * at most one batch of parsed files is held in memory besides the workspace.
+ * Directories are monitored afterwards to keep the index up to date.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "projectindex.h"
+
+#include "app.h"
+#include "document.h"
+#include "filetypes.h"
+#include "geanyobject.h"
+#include "main.h"
+#include "project.h"
+#include "support.h"
+#include "tm_source_file.h"
+#include "tm_workspace.h"
+#include "ui_utils.h"
+#include "utils.h"
+
+#include "gtkcompat.h"
+
+#include <string.h>
+
+
+/* files and tags per batch handed over to the main thread */
+#define BATCH_MAX_FILES		256
+#define BATCH_MAX_TAGS		50000
+/* the number of watched directories is limited by the system (inotify watches) */
+#define MAX_MONITORS		1024
+/* delay to collect file changes before reindexing, in milliseconds */
+#define CHANGES_DELAY		500
+
+
+typedef struct
+{
+	gchar *path;		/* locale encoded */
+	gboolean is_dir;
+}
+IndexJob;
+
+typedef struct
+{
+	GPatternSpec *pattern;
+	const gchar *lang_name;
+}
+LangPattern;
+
+typedef struct
+{
+	GThread *thread;
+	GAsyncQueue *jobs;
+	gint cancelled;			/* accessed atomically */
+
+	/* read-only while the worker runs */
+	gchar *base_path;		/* locale encoded real path */
+	GPtrArray *lang_patterns;
+	GPtrArray *file_patterns;
+
+	/* shared with the worker, protected by lock */
+	GMutex lock;
+	GCond cond;
+	GPtrArray *batch;		/* parsed TMSourceFiles for the main thread */
+	GPtrArray *batch_dirs;	/* crawled directories to monitor */
+	gboolean batch_done;	/* the worker ran out of jobs */
+	guint batch_source;
+
+	/* main thread only */
+	GHashTable *files;		/* real path -> indexed TMSourceFile */
+	GHashTable *monitors;	/* directory path -> GFileMonitor */
+	GHashTable *changes;	/* path -> is_dir, changes waiting for CHANGES_DELAY */
+	guint changes_source;
+	GHashTable *opened;		/* paths of opened documents whose indexed tags are to be removed */
+	guint opened_source;
+	gboolean reported;
+}
+ProjectIndex;
+
+
+static ProjectIndex *project_index = NULL;
+static IndexJob stop_job;
+
+
+static IndexJob *index_job_new(const gchar *path, gboolean is_dir)
+{
+	IndexJob *job = g_new(IndexJob, 1);
+
+	job->path = g_strdup(path);
+	job->is_dir = is_dir;
+	return job;
+}
+
+
+static void index_job_free(IndexJob *job)
+{
+	if (job == &stop_job)
+		return;
+	g_free(job->path);
+	g_free(job);
+}
+
+
+static void lang_pattern_free(LangPattern *lp)
+{
+	g_pattern_spec_free(lp->pattern);
+	g_free(lp);
+}
+
+
+static gboolean is_cancelled(ProjectIndex *pi)
+{
+	return g_atomic_int_get(&pi->cancelled);
+}
+
+
+/* Hands the parsed files over to the main thread and waits until it took them */
+static gboolean on_batch_ready(gpointer data);
+
+static void flush_batch(ProjectIndex *pi, gboolean done)
+{
+	g_mutex_lock(&pi->lock);
+	/* once cancelled, stop_indexing() may free pi before an idle callback would run */
+	if (!is_cancelled(pi) && (pi->batch->len > 0 || pi->batch_dirs->len > 0 || done))
+	{
+		pi->batch_done = done;
+		pi->batch_source = g_idle_add(on_batch_ready, pi);
+		while (pi->batch_source != 0 && !is_cancelled(pi))
+			g_cond_wait(&pi->cond, &pi->lock);
+	}
+	g_mutex_unlock(&pi->lock);
+}
+
+
+static const gchar *get_file_lang_name(ProjectIndex *pi, const gchar *base_name)
+{
+	guint i;
+
+	if (pi->file_patterns->len > 0)
+	{
+		gboolean matched = FALSE;
+
+		for (i = 0; i < pi->file_patterns->len && !matched; i++)
+			matched = g_pattern_match_string(pi->file_patterns->pdata[i], base_name);
+		if (!matched)
+			return NULL;
+	}
+
+	for (i = 0; i < pi->lang_patterns->len; i++)
+	{
+		LangPattern *lp = pi->lang_patterns->pdata[i];
+
+		if (g_pattern_match_string(lp->pattern, base_name))
+			return lp->lang_name;
+	}
+	return NULL;
+}
+
+
+static void index_file(ProjectIndex *pi, const gchar *path, guint *tag_count)
+{
+	const gchar *lang_name;
+	gchar *base_name;
+	TMSourceFile *source_file;
+	guint file_count;
+
+	base_name = g_path_get_basename(path);
+	lang_name = get_file_lang_name(pi, base_name);
+	g_free(base_name);
+
+	if (!lang_name || !g_file_test(path, G_FILE_TEST_IS_REGULAR))
+		return;
+
+	source_file = tm_source_file_new(path, lang_name);
+	if (!source_file)
+		return;
+
+	tm_workspace_parse_source_file(source_file);
+	*tag_count += source_file->tags_array->len;
+
+	g_mutex_lock(&pi->lock);
+	g_ptr_array_add(pi->batch, source_file);
+	file_count = pi->batch->len;
+	g_mutex_unlock(&pi->lock);
+
+	if (file_count >= BATCH_MAX_FILES || *tag_count >= BATCH_MAX_TAGS)
+	{
+		flush_batch(pi, FALSE);
+		*tag_count = 0;
+	}
+}
+
+
+/* Crawls the directory tree iteratively, directory symlinks aren't followed to
+ * avoid cycles */
+static void crawl_dir(ProjectIndex *pi, const gchar *path, guint *tag_count)
+{
+	GQueue dirs = G_QUEUE_INIT;
+	gchar *dir_path;
+
+	g_queue_push_tail(&dirs, g_strdup(path));
+	while ((dir_path = g_queue_pop_head(&dirs)) != NULL)
+	{
+		GDir *dir;
+		const gchar *name;
+
+		if (is_cancelled(pi) || !(dir = g_dir_open(dir_path, 0, NULL)))
+		{
+			g_free(dir_path);
+			continue;
+		}
+
+		while ((name = g_dir_read_name(dir)) != NULL && !is_cancelled(pi))
+		{
+			gchar *file_path;
+
+			/* skip hidden files and directories like .git */
+			if (name[0] == '.')
+				continue;
+
+			file_path = g_build_filename(dir_path, name, NULL);
+			if (g_file_test(file_path, G_FILE_TEST_IS_DIR))
+			{
+				if (!g_file_test(file_path, G_FILE_TEST_IS_SYMLINK))
+				{
+					g_queue_push_tail(&dirs, file_path);
+					continue;
+				}
+			}
+			else
+				index_file(pi, file_path, tag_count);
+			g_free(file_path);
+		}
+		g_dir_close(dir);
+
+		g_mutex_lock(&pi->lock);
+		g_ptr_array_add(pi->batch_dirs, dir_path);
+		g_mutex_unlock(&pi->lock);
+	}
+}
+
+
+static gpointer index_thread(gpointer data)
+{
+	ProjectIndex *pi = data;
+	IndexJob *job;
+	guint tag_count = 0;
+
+	while ((job = g_async_queue_pop(pi->jobs)) != &stop_job)
+	{
+		if (!is_cancelled(pi))
+		{
+			if (job->is_dir)
+				crawl_dir(pi, job->path, &tag_count);
+			else
+				index_file(pi, job->path, &tag_count);
+
+			if (g_async_queue_length(pi->jobs) <= 0)
+			{
+				flush_batch(pi, TRUE);
+				tag_count = 0;
+			}
+		}
+		index_job_free(job);
+	}
+	return NULL;
+}
+
+
+static void remove_indexed_file(ProjectIndex *pi, TMSourceFile *source_file)
+{
+	tm_workspace_remove_source_file(source_file);
+	/* frees source_file */
+	g_hash_table_remove(pi->files, source_file->file_name);
+}
+
+
+static gboolean is_project_path(ProjectIndex *pi, const gchar *path)
+{
+	gsize len = strlen(pi->base_path);
+
+	return strncmp(path, pi->base_path, len) == 0 && path[len] == G_DIR_SEPARATOR;
+}
+
+
+static void on_monitor_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+		GFileMonitorEvent event, gpointer user_data);
+
+static void add_monitor(ProjectIndex *pi, const gchar *dir_path)
+{
+	GFile *file;
+	GFileMonitor *monitor;
+
+	if (g_hash_table_size(pi->monitors) >= MAX_MONITORS ||
+		g_hash_table_lookup(pi->monitors, dir_path))
+		return;
+
+	file = g_file_new_for_path(dir_path);
+	monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, NULL);
+	g_object_unref(file);
+	if (!monitor)
+		return;
+
+	g_signal_connect(monitor, "changed", G_CALLBACK(on_monitor_changed), pi);
+	g_hash_table_insert(pi->monitors, g_strdup(dir_path), monitor);
+}
+
+
+static gboolean on_batch_ready(gpointer data)
+{
+	ProjectIndex *pi = data;
+	GPtrArray *batch, *dirs, *added;
+	gboolean done;
+	guint i;
+
+	g_mutex_lock(&pi->lock);
+	batch = pi->batch;
+	dirs = pi->batch_dirs;
+	done = pi->batch_done;
+	pi->batch = g_ptr_array_new();
+	pi->batch_dirs = g_ptr_array_new_with_free_func(g_free);
+	pi->batch_source = 0;
+	/* let the worker continue while the batch is added */
+	g_cond_signal(&pi->cond);
+	g_mutex_unlock(&pi->lock);
+
+	added = g_ptr_array_sized_new(batch->len);
+	for (i = 0; i < batch->len; i++)
+	{
+		TMSourceFile *source_file = batch->pdata[i];
+		TMSourceFile *old_file;
+
+		/* open documents have their own, possibly modified, tags */
+		if (document_find_by_real_path(source_file->file_name))
+		{
+			tm_source_file_free(source_file);
+			continue;
+		}
+		old_file = g_hash_table_lookup(pi->files, source_file->file_name);
+		if (old_file)
+			remove_indexed_file(pi, old_file);
+		g_hash_table_insert(pi->files, source_file->file_name, source_file);
+		g_ptr_array_add(added, source_file);
+	}
+	tm_workspace_add_parsed_source_files(added);
+
+	for (i = 0; i < dirs->len; i++)
+		add_monitor(pi, dirs->pdata[i]);
+
+	if (done && !pi->reported)
+	{
+		ui_set_statusbar(TRUE, _("Project indexing finished (%u files)."),
+			g_hash_table_size(pi->files));
+		pi->reported = TRUE;
+	}
+
+	g_ptr_array_free(added, TRUE);
+	g_ptr_array_free(batch, TRUE);
+	g_ptr_array_free(dirs, TRUE);
+	return FALSE;
+}
+
+
+static gboolean queue_changes(gpointer data)
+{
+	ProjectIndex *pi = data;
+	GHashTableIter iter;
+	gpointer path, is_dir;
+
+	g_hash_table_iter_init(&iter, pi->changes);
+	while (g_hash_table_iter_next(&iter, &path, &is_dir))
+		g_async_queue_push(pi->jobs, index_job_new(path, GPOINTER_TO_INT(is_dir)));
+	g_hash_table_remove_all(pi->changes);
+
+	pi->changes_source = 0;
+	return FALSE;
+}
+
+
+static void queue_change(ProjectIndex *pi, const gchar *path, gboolean is_dir)
+{
+	g_hash_table_insert(pi->changes, g_strdup(path), GINT_TO_POINTER(is_dir));
+	/* restart the delay so a series of changes is queued at once */
+	if (pi->changes_source != 0)
+		g_source_remove(pi->changes_source);
+	pi->changes_source = g_timeout_add(CHANGES_DELAY, queue_changes, pi);
+}
+
+
+static void remove_deleted_path(ProjectIndex *pi, const gchar *path)
+{
+	TMSourceFile *source_file = g_hash_table_lookup(pi->files, path);
+	GHashTableIter iter;
+	gpointer key, value;
+	GPtrArray *removed;
+	guint i;
+
+	g_hash_table_remove(pi->changes, path);
+	if (source_file)
+	{
+		remove_indexed_file(pi, source_file);
+		return;
+	}
+
+	/* a deleted directory - drop everything indexed below it */
+	if (!g_hash_table_remove(pi->monitors, path))
+		return;
+
+	removed = g_ptr_array_new();
+	g_hash_table_iter_init(&iter, pi->files);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		if (g_str_has_prefix(key, path) && ((gchar *) key)[strlen(path)] == G_DIR_SEPARATOR)
+		{
+			g_ptr_array_add(removed, value);
+			g_hash_table_iter_steal(&iter);
+		}
+	}
+	g_hash_table_iter_init(&iter, pi->monitors);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		if (g_str_has_prefix(key, path) && ((gchar *) key)[strlen(path)] == G_DIR_SEPARATOR)
+			g_hash_table_iter_remove(&iter);
+	}
+
+	tm_workspace_remove_source_files(removed);
+	for (i = 0; i < removed->len; i++)
+		tm_source_file_free(removed->pdata[i]);
+	g_ptr_array_free(removed, TRUE);
+}
+
+
+static void on_monitor_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+		GFileMonitorEvent event, gpointer user_data)
+{
+	ProjectIndex *pi = user_data;
+	gchar *path = g_file_get_path(file);
+	gchar *base_name;
+
+	if (!path)
+		return;
+
+	base_name = g_path_get_basename(path);
+	if (base_name[0] != '.')
+	{
+		switch (event)
+		{
+			case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+				queue_change(pi, path, FALSE);
+				break;
+			case G_FILE_MONITOR_EVENT_CREATED:
+				if (g_file_test(path, G_FILE_TEST_IS_DIR))
+				{
+					if (!g_file_test(path, G_FILE_TEST_IS_SYMLINK))
+						queue_change(pi, path, TRUE);
+				}
+				else
+					queue_change(pi, path, FALSE);
+				break;
+			case G_FILE_MONITOR_EVENT_DELETED:
+				remove_deleted_path(pi, path);
+				break;
+			default:
+				break;
+		}
+	}
+	g_free(base_name);
+	g_free(path);
+}
+
+
+static ProjectIndex *project_index_new(const gchar *base_path)
+{
+	ProjectIndex *pi = g_new0(ProjectIndex, 1);
+	guint i, j;
+
+	pi->base_path = g_strdup(base_path);
+	pi->lang_patterns = g_ptr_array_new_with_free_func((GDestroyNotify) lang_pattern_free);
+	pi->file_patterns = g_ptr_array_new_with_free_func((GDestroyNotify) g_pattern_spec_free);
+
+	/* compile the patterns here, the worker mustn't access the filetypes */
+	for (i = 0; i < filetypes_array->len; i++)
+	{
+		GeanyFiletype *ft = filetypes[i];
+
+		if (ft->id == GEANY_FILETYPES_NONE || !filetype_has_tags(ft))
+			continue;
+		for (j = 0; ft->pattern[j] != NULL; j++)
+		{
+			LangPattern *lp = g_new(LangPattern, 1);
+
+			lp->pattern = g_pattern_spec_new(ft->pattern[j]);
+			lp->lang_name = tm_source_file_get_lang_name(ft->lang);
+			g_ptr_array_add(pi->lang_patterns, lp);
+		}
+	}
+	if (app->project->file_patterns)
+	{
+		for (i = 0; app->project->file_patterns[i] != NULL; i++)
+		{
+			if (!EMPTY(app->project->file_patterns[i]))
+				g_ptr_array_add(pi->file_patterns, g_pattern_spec_new(app->project->file_patterns[i]));
+		}
+	}
+
+	g_mutex_init(&pi->lock);
+	g_cond_init(&pi->cond);
+	pi->jobs = g_async_queue_new_full((GDestroyNotify) index_job_free);
+	pi->batch = g_ptr_array_new();
+	pi->batch_dirs = g_ptr_array_new_with_free_func(g_free);
+
+	/* the source files are freed after removing them from the workspace */
+	pi->files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify) tm_source_file_free);
+	pi->monitors = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+	pi->changes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	pi->opened = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	return pi;
+}
+
+
+static void stop_indexing(void)
+{
+	ProjectIndex *pi = project_index;
+	GPtrArray *indexed;
+	GHashTableIter iter;
+	gpointer value;
+	guint i;
+
+	if (!pi)
+		return;
+	project_index = NULL;
+
+	g_atomic_int_set(&pi->cancelled, TRUE);
+	g_mutex_lock(&pi->lock);
+	if (pi->batch_source != 0)
+	{
+		g_source_remove(pi->batch_source);
+		pi->batch_source = 0;
+	}
+	g_cond_signal(&pi->cond);
+	g_mutex_unlock(&pi->lock);
+
+	g_async_queue_push(pi->jobs, &stop_job);
+	g_thread_join(pi->thread);
+
+	/* in case the worker flushed a batch before it saw the cancellation */
+	if (pi->batch_source != 0)
+		g_source_remove(pi->batch_source);
+	if (pi->changes_source != 0)
+		g_source_remove(pi->changes_source);
+	if (pi->opened_source != 0)
+		g_source_remove(pi->opened_source);
+
+	/* files parsed but not yet added to the workspace */
+	for (i = 0; i < pi->batch->len; i++)
+		tm_source_file_free(pi->batch->pdata[i]);
+
+	indexed = g_ptr_array_new();
+	g_hash_table_iter_init(&iter, pi->files);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		g_ptr_array_add(indexed, value);
+	tm_workspace_remove_source_files(indexed);
+	g_ptr_array_free(indexed, TRUE);
+
+	g_hash_table_destroy(pi->files);
+	g_hash_table_destroy(pi->monitors);
+	g_hash_table_destroy(pi->changes);
+	g_hash_table_destroy(pi->opened);
+	g_ptr_array_free(pi->batch, TRUE);
+	g_ptr_array_free(pi->batch_dirs, TRUE);
+	g_async_queue_unref(pi->jobs);
+	g_mutex_clear(&pi->lock);
+	g_cond_clear(&pi->cond);
+	g_ptr_array_free(pi->lang_patterns, TRUE);
+	g_ptr_array_free(pi->file_patterns, TRUE);
+	g_free(pi->base_path);
+	g_free(pi);
+}
+
+
+static void start_indexing(void)
+{
+	gchar *utf8_base_path, *locale_base_path, *base_path;
+
+	utf8_base_path = project_get_base_path();
+	locale_base_path = utils_get_locale_from_utf8(utf8_base_path);
+	base_path = tm_get_real_path(locale_base_path);
+
+	if (base_path && g_file_test(base_path, G_FILE_TEST_IS_DIR))
+	{
+		project_index = project_index_new(base_path);
+		g_async_queue_push(project_index->jobs, index_job_new(base_path, TRUE));
+		project_index->thread = g_thread_new("project-index", index_thread, project_index);
+	}
+
+	g_free(base_path);
+	g_free(locale_base_path);
+	g_free(utf8_base_path);
+}
+
+
+static void on_project_open(G_GNUC_UNUSED GObject *obj, GKeyFile *config,
+		G_GNUC_UNUSED gpointer user_data)
+{
+	stop_indexing();
+	if (utils_get_setting_boolean(config, "project", "index_files", FALSE))
+		start_indexing();
+}
+
+
+static void on_project_close(G_GNUC_UNUSED GObject *obj, G_GNUC_UNUSED gpointer user_data)
+{
+	stop_indexing();
+}
+
+
+static gboolean remove_opened_files(gpointer data)
+{
+	ProjectIndex *pi = data;
+	GHashTableIter iter;
+	gpointer path;
+
+	g_hash_table_iter_init(&iter, pi->opened);
+	while (g_hash_table_iter_next(&iter, &path, NULL))
+	{
+		TMSourceFile *source_file = g_hash_table_lookup(pi->files, path);
+
+		/* the document may have been closed again meanwhile */
+		if (source_file && document_find_by_real_path(path))
+			remove_indexed_file(pi, source_file);
+	}
+	g_hash_table_remove_all(pi->opened);
+
+	pi->opened_source = 0;
+	return FALSE;
+}
+
+
+static void on_document_open(G_GNUC_UNUSED GObject *obj, GeanyDocument *doc,
+		G_GNUC_UNUSED gpointer user_data)
+{
+	ProjectIndex *pi = project_index;
+
+	if (!pi || !doc->real_path || !g_hash_table_lookup(pi->files, doc->real_path))
+		return;
+
+	/* the document's tags replace the indexed ones. They are removed later as the code
+	 * opening the document, and other handlers of this signal, can still use them. */
+	g_hash_table_insert(pi->opened, g_strdup(doc->real_path), NULL);
+	if (pi->opened_source == 0)
+		pi->opened_source = g_idle_add(remove_opened_files, pi);
+}
+
+
+static void on_document_close(G_GNUC_UNUSED GObject *obj, GeanyDocument *doc,
+		G_GNUC_UNUSED gpointer user_data)
+{
+	if (!project_index || !doc->real_path || main_status.quitting || main_status.closing_all)
+		return;
+
+	/* the index needs the saved version of the file instead of the document's tags */
+	if (is_project_path(project_index, doc->real_path))
+		queue_change(project_index, doc->real_path, FALSE);
+}
+
+
+void project_index_init(void)
+{
+	g_signal_connect(geany_object, "project-open", G_CALLBACK(on_project_open), NULL);
+	g_signal_connect(geany_object, "project-close", G_CALLBACK(on_project_close), NULL);
+	g_signal_connect(geany_object, "document-open", G_CALLBACK(on_document_open), NULL);
+	g_signal_connect(geany_object, "document-close", G_CALLBACK(on_document_close), NULL);
+}
+
+
+void project_index_finalize(void)
+{
+	stop_indexing();
+}
@@ -34,6 +34,7 @@
 #include "document.h"
 #include "encodings.h"
 #include "encodingsprivate.h"
+#include "findinfiles.h"
 #include "keyfile.h"
 #include "msgwindow.h"
 #include "prefs.h"
@@ -113,6 +114,9 @@ static StashGroup *fif_prefs = NULL;
 static StashGroup *find_prefs = NULL;
 static StashGroup *replace_prefs = NULL;
 
+/* lines printed by grep, the Messages tab may not keep them all */
+static gint fif_match_count = 0;
+
 
 static struct
 {
@@ -289,6 +293,7 @@ void search_finalize(void)
 	FREE_WIDGET(find_dlg.dialog);
 	FREE_WIDGET(replace_dlg.dialog);
 	FREE_WIDGET(fif_dlg.dialog);
+	find_in_files_cancel();
 	g_free(search_data.text);
 	g_free(search_data.original_text);
 }
@@ -962,7 +967,8 @@ static void create_fif_dialog(void)
 	check_regexp = gtk_check_button_new_with_mnemonic(_("_Use regular expressions"));
 	ui_hookup_widget(fif_dlg.dialog, check_regexp, "check_regexp");
 	gtk_button_set_focus_on_click(GTK_BUTTON(check_regexp), FALSE);
-	gtk_widget_set_tooltip_text(check_regexp, _("See grep's manual page for more information"));
+	gtk_widget_set_tooltip_text(check_regexp, _("Use Perl-like regular expressions like the Find dialog. "
+		"When Extra options are used, Grep's extended regular expressions (grep -E) are used instead."));
 
 	check_recursive = gtk_check_button_new_with_mnemonic(_("_Recurse in subfolders"));
 	ui_hookup_widget(fif_dlg.dialog, check_recursive, "check_recursive");
@@ -1593,6 +1599,36 @@ static GString *get_grep_options(void)
 }
 
 
+/* grep is only needed for its own extra options */
+static gboolean fif_uses_grep(void)
+{
+	g_strstrip(settings.fif_extra_options);
+	return settings.fif_use_extra_options && *settings.fif_extra_options != 0;
+}
+
+
+static gboolean
+search_find_in_files_builtin(const gchar *utf8_search_text, const gchar *utf8_dir, const gchar *enc)
+{
+	FindInFilesOptions options = {0};
+	gboolean ret;
+
+	options.regexp = settings.fif_regexp;
+	options.case_sensitive = settings.fif_case_sensitive;
+	options.whole_word = settings.fif_match_whole_word;
+	options.invert = settings.fif_invert_results;
+	options.recursive = settings.fif_recursive;
+
+	g_strstrip(settings.fif_files);
+	if (settings.fif_files_mode != FILES_MODE_ALL && *settings.fif_files)
+		options.file_patterns = g_strsplit(settings.fif_files, " ", -1);
+
+	ret = find_in_files_start(utf8_search_text, utf8_dir, enc, &options);
+	g_strfreev(options.file_patterns);
+	return ret;
+}
+
+
 static void
 on_find_in_files_dialog_response(GtkDialog *dialog, gint response,
 		G_GNUC_UNUSED gpointer user_data)
@@ -1616,18 +1652,27 @@ on_find_in_files_dialog_response(GtkDialog *dialog, gint response,
 			ui_set_statusbar(FALSE, _("Invalid directory for find in files."));
 		else if (!EMPTY(search_text))
 		{
-			GString *opts = get_grep_options();
 			const gchar *enc = (enc_idx == GEANY_ENCODING_UTF_8) ? NULL :
 				encodings_get_charset_from_index(enc_idx);
+			gboolean started;
+
+			if (fif_uses_grep())
+			{
+				GString *opts = get_grep_options();
+
+				started = search_find_in_files(search_text, utf8_dir, opts->str, enc);
+				g_string_free(opts, TRUE);
+			}
+			else
+				started = search_find_in_files_builtin(search_text, utf8_dir, enc);
 
-			if (search_find_in_files(search_text, utf8_dir, opts->str, enc))
+			if (started)
 			{
 				ui_combo_box_add_to_history(GTK_COMBO_BOX_TEXT(search_combo), search_text, 0);
 				ui_combo_box_add_to_history(GTK_COMBO_BOX_TEXT(fif_dlg.files_combo), NULL, 0);
 				ui_combo_box_add_to_history(GTK_COMBO_BOX_TEXT(dir_combo), utf8_dir, 0);
 				gtk_widget_hide(fif_dlg.dialog);
 			}
-			g_string_free(opts, TRUE);
 		}
 		else
 			ui_set_statusbar(FALSE, _("No text to find."));
@@ -1695,8 +1740,11 @@ search_find_in_files(const gchar *utf8_search_text, const gchar *utf8_dir, const
 		}
 	}
 
-	gtk_list_store_clear(msgwindow.store_msg);
+	/* a running built-in search would add its lines to ours */
+	find_in_files_cancel();
+	msgwin_clear_tab(MSG_MESSAGE);
 	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_MESSAGE);
+	fif_match_count = 0;
 
 	/* we can pass 'enc' without strdup'ing it here because it's a global const string and
 	 * always exits longer than the lifetime of this function */
@@ -1834,6 +1882,8 @@ static void read_fif_io(gchar *msg, GIOCondition condition, gchar *enc, gint msg
 
 static void search_read_io(GString *string, GIOCondition condition, gpointer data)
 {
+	if (condition & (G_IO_IN | G_IO_PRI))
+		fif_match_count++;
 	read_fif_io(string->str, condition, data, COLOR_BLACK);
 }
 
@@ -1867,8 +1917,7 @@ static void search_finished(GPid child_pid, gint status, gpointer user_data)
 	{
 		case 0:
 		{
-			gint count = gtk_tree_model_iter_n_children(
-				GTK_TREE_MODEL(msgwindow.store_msg), NULL) - 1;
+			gint count = fif_match_count;
 			gchar *text = ngettext(
 						"Search completed with %d match.",
 						"Search completed with %d matches.", count);
@@ -1923,55 +1972,193 @@ static gchar *get_regex_match_string(const gchar *text, const GeanyMatchInfo *ma
 }
 
 
-static gint find_regex(ScintillaObject *sci, guint pos, GRegex *regex, gboolean multiline, GeanyMatchInfo *match)
+#if GLIB_CHECK_VERSION(2, 34, 0)
+/* text copied at least after a segment end when a match may cross it */
+#define REGEX_CROSSING_SIZE 65536
+
+static gint get_line_start_at(ScintillaObject *sci, gint pos)
 {
-	const gchar *text;
-	GMatchInfo *minfo;
-	guint document_length;
-	gint ret = -1;
-	gint offset = 0;
+	return sci_get_position_from_line(sci, sci_get_line_from_position(sci, pos));
+}
 
-	document_length = (guint)sci_get_length(sci);
-	if (document_length <= 0)
-		return -1; /* skip empty documents */
 
-	g_return_val_if_fail(pos <= document_length, -1);
+/* Returns the start of the contiguous segment of the Scintilla buffer containing pos */
+static gint get_segment_start(ScintillaObject *sci, gint pos)
+{
+	gint start = 0;
+	gint end;
 
-	if (multiline)
+	while ((end = (gint) scintilla_send_message(sci, SCI_GETSEGMENTEND, start, 0)) <= pos)
+		start = end;
+	return start;
+}
+
+
+/* Matches regex from pos without moving the Scintilla gap or merging the blocks of a
+ * large document. Each contiguous segment of the buffer is matched in place up to its
+ * last line start, so that anchors and lookbehinds see the text of the segment before
+ * pos and partial matching tells whether the end of the subject mattered. Only the
+ * text around a segment end is copied when a match may cross it, starting at the line
+ * break before the line of the match. *copy has to be freed after minfo. */
+static gboolean find_regex_multiline(ScintillaObject *sci, gint pos, GRegex *regex,
+		GMatchInfo **minfo, gint *offset, gchar **copy)
+{
+	gint length = sci_get_length(sci);
+
+	*copy = NULL;
+	for (;;)
 	{
-		/* Warning: any SCI calls will invalidate 'text' after calling SCI_GETCHARACTERPOINTER */
-		text = (void*)scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
-		g_regex_match_full(regex, text, -1, pos, 0, &minfo, NULL);
+		gint from = get_segment_start(sci, MIN(pos, length - 1));
+		gint seg_end = (gint) scintilla_send_message(sci, SCI_GETSEGMENTEND, from, 0);
+		GRegexMatchFlags flags = from > 0 ? G_REGEX_MATCH_NOTBOL : 0;
+		const gchar *text;
+		gint end, size;
+		gboolean partial;
+
+		/* a search from the segment start needs the text before it */
+		gboolean in_place = pos > from || from == 0;
+
+		*offset = from;
+		if (seg_end >= length && in_place)
+		{
+			text = (void*)scintilla_send_message(sci, SCI_GETRANGEPOINTER, from, length - from);
+			return g_regex_match_full(regex, text, length - from, pos - from, flags, minfo, NULL);
+		}
+
+		/* a complete match before the last line start of the segment didn't depend
+		 * on the text after it */
+		end = get_line_start_at(sci, seg_end);
+		if (end > pos && in_place)
+		{
+			text = (void*)scintilla_send_message(sci, SCI_GETRANGEPOINTER, from, end - from);
+			if (g_regex_match_full(regex, text, end - from, pos - from,
+				flags | G_REGEX_MATCH_PARTIAL_HARD, minfo, NULL))
+				return TRUE;
+			partial = g_match_info_is_partial_match(*minfo);
+			g_match_info_free(*minfo);
+			*minfo = NULL;
+			if (!partial)
+			{
+				pos = end;
+				continue;
+			}
+		}
+
+		/* the match may cross the segment end, so copy the text around it and copy
+		 * more while the match is partial */
+		from = get_line_start_at(sci, pos);
+		from = from > 0 ? from - 1 : 0;
+		flags = from > 0 ? G_REGEX_MATCH_NOTBOL : 0;
+		*offset = from;
+		for (size = REGEX_CROSSING_SIZE; ; size *= 2)
+		{
+			gint line = sci_get_line_from_position(sci, MIN(seg_end + size, length));
+
+			end = line + 1 < sci_get_line_count(sci) ? sci_get_position_from_line(sci, line + 1) : length;
+			*copy = sci_get_contents_range(sci, from, end);
+			if (g_regex_match_full(regex, *copy, end - from, pos - from,
+				end < length ? flags | G_REGEX_MATCH_PARTIAL_HARD : flags, minfo, NULL))
+				return TRUE;
+			partial = end < length && g_match_info_is_partial_match(*minfo);
+			g_match_info_free(*minfo);
+			*minfo = NULL;
+			g_free(*copy);
+			*copy = NULL;
+			if (!partial)
+				break;
+		}
+		/* no match starts before end, which is a line start after the segment end */
+		if (end >= length)
+			return FALSE;
+		pos = end;
 	}
-	else /* single-line mode, manually match against each line */
+}
+#else
+/* Matches regex against the whole document from pos, which moves the Scintilla gap
+ * to its end */
+static gboolean find_regex_multiline(ScintillaObject *sci, gint pos, GRegex *regex,
+		GMatchInfo **minfo, gint *offset, gchar **copy)
+{
+	const gchar *text = (void*)scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+
+	*offset = 0;
+	*copy = NULL;
+	return g_regex_match_full(regex, text, sci_get_length(sci), pos, 0, minfo, NULL);
+}
+#endif
+
+
+/* lines of roughly this many bytes are read at once in single-line mode */
+#define REGEX_BLOCK_SIZE 65536
+
+static gboolean find_regex_lines(ScintillaObject *sci, gint pos, GRegex *regex,
+		GMatchInfo **minfo, gint *offset)
+{
+	gint length = sci_get_length(sci);
+	gint line_count = sci_get_line_count(sci);
+	gint line = sci_get_line_from_position(sci, pos);
+
+	while (line < line_count)
 	{
-		gint line = sci_get_line_from_position(sci, pos);
+		gint block_start = sci_get_position_from_line(sci, line);
+		gint last_line = sci_get_line_from_position(sci, MIN(block_start + REGEX_BLOCK_SIZE, length));
+		gint block_end = sci_get_line_end_position(sci, last_line);
+		const gchar *text;
+		gint start;
 
+		/* split the block into lines here instead of asking Scintilla for each line */
+		text = (void*)scintilla_send_message(sci, SCI_GETRANGEPOINTER, block_start, block_end - block_start);
+		start = block_start;
 		for (;;)
 		{
-			gint start = sci_get_position_from_line(sci, line);
-			gint end = sci_get_line_end_position(sci, line);
+			const gchar *line_text = text + (start - block_start);
+			gint end = start;
 
-			text = (void*)scintilla_send_message(sci, SCI_GETRANGEPOINTER, start, end - start);
-			if (g_regex_match_full(regex, text, end - start, pos - start, 0, &minfo, NULL))
-			{
-				offset = start;
-				break;
-			}
-			else /* not found, try next line */
+			while (end < block_end && text[end - block_start] != '\r' && text[end - block_start] != '\n')
+				end++;
+
+			if (g_regex_match_full(regex, line_text, end - start, MAX(pos, start) - start, 0, minfo, NULL))
 			{
-				line ++;
-				if (line >= sci_get_line_count(sci))
-					break;
-				pos = sci_get_position_from_line(sci, line);
-				/* don't free last info, it's freed below */
-				g_match_info_free(minfo);
+				*offset = start;
+				return TRUE;
 			}
+			g_match_info_free(*minfo);
+			*minfo = NULL;
+
+			if (end >= block_end)
+				break;
+			/* skip the line ending */
+			if (text[end - block_start] == '\r' && end + 1 < block_end && text[end + 1 - block_start] == '\n')
+				end++;
+			start = end + 1;
 		}
+		line = last_line + 1;
 	}
+	return FALSE;
+}
+
+
+static gint find_regex(ScintillaObject *sci, guint pos, GRegex *regex, gboolean multiline, GeanyMatchInfo *match)
+{
+	GMatchInfo *minfo = NULL;
+	guint document_length;
+	gint ret = -1;
+	gint offset = 0;
+	gchar *copy = NULL;
+
+	document_length = (guint)sci_get_length(sci);
+	if (document_length <= 0)
+		return -1; /* skip empty documents */
+
+	g_return_val_if_fail(pos <= document_length, -1);
 
-	/* Warning: minfo will become invalid when 'text' does! */
-	if (g_match_info_matches(minfo))
+	if (multiline)
+		find_regex_multiline(sci, (gint) pos, regex, &minfo, &offset, &copy);
+	else /* single-line mode, manually match against each line */
+		find_regex_lines(sci, (gint) pos, regex, &minfo, &offset);
+
+	/* Warning: minfo will become invalid when the text does! */
+	if (minfo && g_match_info_matches(minfo))
 	{
 		guint i;
 
@@ -1990,7 +2177,9 @@ static gint find_regex(ScintillaObject *sci, guint pos, GRegex *regex, gboolean
 		match->end = match->matches[0].end;
 		ret = match->start;
 	}
-	g_match_info_free(minfo);
+	if (minfo)
+		g_match_info_free(minfo);
+	g_free(copy);
 	return ret;
 }
 
@@ -2143,6 +2332,221 @@ gint search_find_text(ScintillaObject *sci, GeanyFindFlags flags, struct Sci_Tex
 }
 
 
+/* a match found by a Find Usage job */
+typedef struct
+{
+	gint start;
+	gint end;
+	gint line;
+	guint line_text;	/* index in UsageJob::line_texts */
+}
+UsageMatch;
+
+/* the search of one document, which can run in a worker thread */
+typedef struct
+{
+	GeanyDocument *doc;
+	const gchar *text;		/* the document's buffer, unchanged while searching */
+	gint length;
+	GArray *matches;		/* UsageMatch */
+	GPtrArray *line_texts;	/* stripped text of the lines with matches */
+	gint line;				/* line at pos, used to count lines incrementally */
+	gint line_start;
+	gint pos;
+}
+UsageJob;
+
+typedef struct
+{
+	const gchar *text;
+	gsize text_len;
+	GRegex *regex;			/* NULL for plain text searches */
+	gboolean multiline;
+	/* whole word matches are checked by Scintilla afterwards, so all candidates are
+	 * needed, even overlapping ones */
+	gboolean whole_word;
+}
+UsageSearch;
+
+
+/* Moves the line counter of job to pos, counting line endings like Scintilla does */
+static void usage_job_seek(UsageJob *job, gint pos)
+{
+	for (; job->pos < pos; job->pos++)
+	{
+		gchar c = job->text[job->pos];
+
+		if (c == '\n' || (c == '\r' && (job->pos + 1 >= job->length || job->text[job->pos + 1] != '\n')))
+		{
+			job->line++;
+			job->line_start = job->pos + 1;
+		}
+	}
+}
+
+
+static void usage_job_add(UsageJob *job, gint start, gint end)
+{
+	UsageMatch match;
+
+	usage_job_seek(job, start);
+	match.start = start;
+	match.end = end;
+	match.line = job->line;
+	if (job->matches->len > 0 && g_array_index(job->matches, UsageMatch, job->matches->len - 1).line == job->line)
+		match.line_text = job->line_texts->len - 1;
+	else
+	{
+		gint line_end = start;
+
+		while (line_end < job->length && job->text[line_end] != '\r' && job->text[line_end] != '\n')
+			line_end++;
+		match.line_text = job->line_texts->len;
+		g_ptr_array_add(job->line_texts,
+			g_strstrip(g_strndup(job->text + job->line_start, line_end - job->line_start)));
+	}
+	g_array_append_val(job->matches, match);
+}
+
+
+/* Finds the matches like find_range() with search_find_text() would do */
+static void usage_job_run(gpointer data, gpointer user_data)
+{
+	UsageJob *job = data;
+	UsageSearch *search = user_data;
+	GMatchInfo *minfo;
+	gint pos = 0;
+
+	if (!search->regex)
+	{
+		const gchar *found;
+
+		while ((found = utils_find_bytes(job->text + pos, job->length - pos, search->text, search->text_len)))
+		{
+			gint start = found - job->text;
+
+			usage_job_add(job, start, start + search->text_len);
+			pos = search->whole_word ? start + 1 : start + (gint) search->text_len;
+		}
+	}
+	else if (search->multiline)
+	{
+		while (pos <= job->length)
+		{
+			gint start, end;
+
+			/* the whole text is the subject, like in find_regex_multiline() */
+			if (!g_regex_match_full(search->regex, job->text, job->length, pos, 0, &minfo, NULL))
+			{
+				g_match_info_free(minfo);
+				break;
+			}
+			g_match_info_fetch_pos(minfo, 0, &start, &end);
+			g_match_info_free(minfo);
+			usage_job_add(job, start, end);
+			/* avoid rematching empty matches */
+			pos = (end == start) ? end + 1 : end;
+		}
+	}
+	else
+	{
+		/* match each line on its own */
+		while (pos <= job->length)
+		{
+			gint line_end, start, end;
+			gboolean matched = FALSE;
+
+			usage_job_seek(job, pos);
+			line_end = job->line_start;
+			while (line_end < job->length && job->text[line_end] != '\r' && job->text[line_end] != '\n')
+				line_end++;
+
+			if (pos <= line_end)
+			{
+				matched = g_regex_match_full(search->regex, job->text + job->line_start,
+					line_end - job->line_start, pos - job->line_start, 0, &minfo, NULL);
+				if (matched)
+					g_match_info_fetch_pos(minfo, 0, &start, &end);
+				g_match_info_free(minfo);
+			}
+
+			if (matched)
+			{
+				start += job->line_start;
+				end += job->line_start;
+				usage_job_add(job, start, end);
+				pos = (end == start) ? end + 1 : end;
+			}
+			else if (line_end >= job->length)
+				break;
+			else
+			{
+				/* continue at the next line */
+				pos = line_end + 1;
+				if (job->text[line_end] == '\r' && pos < job->length && job->text[pos] == '\n')
+					pos++;
+			}
+		}
+	}
+}
+
+
+/* Adds the matches of job to the Messages tab, returns the number of matches */
+static gint usage_job_show(UsageJob *job, const UsageSearch *search)
+{
+	ScintillaObject *sci = job->doc->editor->sci;
+	gchar *short_file_name = g_path_get_basename(DOC_FILENAME(job->doc));
+	gint count = 0;
+	gint prev_line = -1;
+	gint next_start = 0;
+	guint i;
+
+	for (i = 0; i < job->matches->len; i++)
+	{
+		UsageMatch *match = &g_array_index(job->matches, UsageMatch, i);
+
+		if (search->whole_word)
+		{
+			/* like Scintilla, skip candidates overlapping the previous match */
+			if (match->start < next_start ||
+				!scintilla_send_message(sci, SCI_ISRANGEWORD, match->start, match->end))
+				continue;
+			next_start = match->end;
+		}
+		if (match->line != prev_line)
+		{
+			msgwin_msg_add(COLOR_BLACK, match->line + 1, job->doc, "%s:%d: %s",
+				short_file_name, match->line + 1, (gchar *) job->line_texts->pdata[match->line_text]);
+			prev_line = match->line;
+		}
+		count++;
+	}
+	g_free(short_file_name);
+	return count;
+}
+
+
+static gint compare_documents_by_name(gconstpointer a, gconstpointer b)
+{
+	GeanyDocument *doc_a = *(GeanyDocument **) a;
+	GeanyDocument *doc_b = *(GeanyDocument **) b;
+
+	return utils_str_casecmp(DOC_FILENAME(doc_a), DOC_FILENAME(doc_b));
+}
+
+
+/* Scintilla's case folding and word start checks aren't reproduced, these searches
+ * are done by Scintilla */
+static gboolean usage_search_needs_scintilla(const gchar *search_text, GeanyFindFlags flags)
+{
+	if (flags & GEANY_FIND_REGEXP)
+		return FALSE;
+	/* a UTF-8 trail byte could match inside a character */
+	return !(flags & GEANY_FIND_MATCHCASE) || (flags & GEANY_FIND_WORDSTART) ||
+		((guchar) search_text[0] & 0xC0) == 0x80;
+}
+
+
 static gint find_document_usage(GeanyDocument *doc, const gchar *search_text, GeanyFindFlags flags)
 {
 	gchar *buffer, *short_file_name;
@@ -2183,11 +2587,77 @@ static gint find_document_usage(GeanyDocument *doc, const gchar *search_text, Ge
 }
 
 
+/* Searches the documents in parallel. The buffers stay valid because the main loop
+ * doesn't run until all jobs are done. */
+static gint find_documents_usage(GPtrArray *docs, const gchar *search_text, GeanyFindFlags flags)
+{
+	UsageSearch search = {0};
+	GPtrArray *jobs;
+	gint count = 0;
+	guint i;
+
+	search.text = search_text;
+	search.text_len = strlen(search_text);
+	if (flags & GEANY_FIND_REGEXP)
+	{
+		search.regex = compile_regex(search_text, flags);
+		if (!search.regex)
+			return 0;
+		search.multiline = (flags & GEANY_FIND_MULTILINE) != 0;
+	}
+	else
+		search.whole_word = (flags & GEANY_FIND_WHOLEWORD) != 0;
+
+	jobs = g_ptr_array_sized_new(docs->len);
+	for (i = 0; i < docs->len; i++)
+	{
+		GeanyDocument *doc = docs->pdata[i];
+		UsageJob *job = g_new0(UsageJob, 1);
+
+		job->doc = doc;
+		job->length = sci_get_length(doc->editor->sci);
+		job->text = (const gchar *) scintilla_send_message(doc->editor->sci, SCI_GETCHARACTERPOINTER, 0, 0);
+		job->matches = g_array_new(FALSE, FALSE, sizeof(UsageMatch));
+		job->line_texts = g_ptr_array_new_with_free_func(g_free);
+		g_ptr_array_add(jobs, job);
+	}
+
+	if (jobs->len == 1)
+		usage_job_run(jobs->pdata[0], &search);
+	else if (jobs->len > 1)
+	{
+		GThreadPool *pool = g_thread_pool_new(usage_job_run, &search,
+			MIN(utils_get_thread_count(), jobs->len), FALSE, NULL);
+
+		for (i = 0; i < jobs->len; i++)
+			g_thread_pool_push(pool, jobs->pdata[i], NULL);
+		/* wait for all jobs */
+		g_thread_pool_free(pool, FALSE, TRUE);
+	}
+
+	for (i = 0; i < jobs->len; i++)
+	{
+		UsageJob *job = jobs->pdata[i];
+
+		count += usage_job_show(job, &search);
+		g_array_free(job->matches, TRUE);
+		g_ptr_array_free(job->line_texts, TRUE);
+		g_free(job);
+	}
+	g_ptr_array_free(jobs, TRUE);
+	if (search.regex)
+		g_regex_unref(search.regex);
+	return count;
+}
+
+
 void search_find_usage(const gchar *search_text, const gchar *original_search_text,
 		GeanyFindFlags flags, gboolean in_session)
 {
 	GeanyDocument *doc;
+	GPtrArray *docs;
 	gint count = 0;
+	guint i;
 
 	doc = document_get_current();
 	g_return_if_fail(doc != NULL);
@@ -2199,23 +2669,29 @@ void search_find_usage(const gchar *search_text, const gchar *original_search_te
 	}
 
 	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_MESSAGE);
-	gtk_list_store_clear(msgwindow.store_msg);
+	msgwin_clear_tab(MSG_MESSAGE);
 
+	docs = g_ptr_array_new();
 	if (! in_session)
 	{	/* use current document */
-		count = find_document_usage(doc, search_text, flags);
+		g_ptr_array_add(docs, doc);
 	}
 	else
 	{
-		guint i;
-		for (i = 0; i < documents_array->len; i++)
-		{
-			if (documents[i]->is_valid)
-			{
-				count += find_document_usage(documents[i], search_text, flags);
-			}
-		}
+		foreach_document(i)
+			g_ptr_array_add(docs, documents[i]);
+	}
+
+	/* show the results sorted by file name */
+	g_ptr_array_sort(docs, compare_documents_by_name);
+	if (usage_search_needs_scintilla(search_text, flags))
+	{
+		for (i = 0; i < docs->len; i++)
+			count += find_document_usage(docs->pdata[i], search_text, flags);
 	}
+	else
+		count = find_documents_usage(docs, search_text, flags);
+	g_ptr_array_free(docs, TRUE);
 
 	if (count == 0) /* no matches were found */
 	{
@@ -75,6 +75,18 @@ typedef struct
 
 static GPtrArray *top_level_iter_names = NULL;
 
+/* The workspace type names of a language as a word set for lexers, shared by
+ * the documents of the language */
+typedef struct
+{
+	Sci_WordSet word_set;	/* first, so the lexer's pointer is to the TypenameSet */
+	TMParserType lang;
+	gint refcount;
+}
+TypenameSet;
+
+static TypenameSet *typename_sets[TM_PARSER_COUNT];
+
 enum
 {
 	ICON_CLASS,
@@ -206,6 +218,49 @@ void symbols_global_tags_loaded(guint file_type_idx)
 }
 
 
+static int typename_set_contains(const Sci_WordSet *word_set, const char *word)
+{
+	const TypenameSet *set = (const TypenameSet *) word_set;
+
+	return tm_workspace_is_typename(word, set->lang);
+}
+
+
+/* Returns a word set of the type names of the workspace for lang, which is kept
+ * up to date when tags change. Release it with symbols_typenames_unref(). */
+Sci_WordSet *symbols_typenames_ref(TMParserType lang)
+{
+	TypenameSet *set;
+
+	g_return_val_if_fail(lang >= 0 && lang < TM_PARSER_COUNT, NULL);
+
+	set = typename_sets[lang];
+	if (set == NULL)
+	{
+		set = g_new0(TypenameSet, 1);
+		set->word_set.contains = typename_set_contains;
+		set->lang = lang;
+		typename_sets[lang] = set;
+	}
+	set->refcount++;
+	return &set->word_set;
+}
+
+
+void symbols_typenames_unref(Sci_WordSet *word_set)
+{
+	TypenameSet *set = (TypenameSet *) word_set;
+
+	g_return_if_fail(set != NULL && set->refcount > 0);
+
+	if (--set->refcount == 0)
+	{
+		typename_sets[set->lang] = NULL;
+		g_free(set);
+	}
+}
+
+
 GString *symbols_find_typenames_as_string(TMParserType lang, gboolean global)
 {
 	guint j;
@@ -1607,7 +1662,7 @@ static GeanyFiletype *detect_global_tags_filetype(const gchar *utf8_filename)
  * the relevant path.
  * Example:
  * CFLAGS=-I/home/user/libname-1.x geany -g libname.d.tags libname.h */
-int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess)
+int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess, gboolean binary)
 {
 	/* -E pre-process, -dD output user macros, -p prof info (?) */
 	const char pre_process[] = "gcc -E -dD -p -I.";
@@ -1637,19 +1692,28 @@ int symbols_generate_global_tags(int argc, char **argv, gboolean want_preprocess
 		if (ft->id == GEANY_FILETYPES_C || ft->id == GEANY_FILETYPES_CPP)
 			load_c_ignore_tags();
 
-		if (want_preprocess && (ft->id == GEANY_FILETYPES_C || ft->id == GEANY_FILETYPES_CPP))
+		tm_get_workspace();
+		if (argc == 3 && g_str_has_suffix(argv[2], ".tags"))
 		{
-			const gchar *cflags = getenv("CFLAGS");
-			command = g_strdup_printf("%s %s", pre_process, FALLBACK(cflags, ""));
+			/* convert an existing tags file, e.g. to the binary format */
+			geany_debug("Converting %s tags file.", ft->name);
+			status = tm_workspace_convert_global_tags(argv[2], tags_file, ft->lang, binary);
 		}
 		else
-			command = NULL;	/* don't preprocess */
+		{
+			if (want_preprocess && (ft->id == GEANY_FILETYPES_C || ft->id == GEANY_FILETYPES_CPP))
+			{
+				const gchar *cflags = getenv("CFLAGS");
+				command = g_strdup_printf("%s %s", pre_process, FALLBACK(cflags, ""));
+			}
+			else
+				command = NULL;	/* don't preprocess */
 
-		geany_debug("Generating %s tags file.", ft->name);
-		tm_get_workspace();
-		status = tm_workspace_create_global_tags(command, (const char **) (argv + 2),
-												 argc - 2, tags_file, ft->lang);
-		g_free(command);
+			geany_debug("Generating %s tags file.", ft->name);
+			status = tm_workspace_create_global_tags(command, (const char **) (argv + 2),
+													 argc - 2, tags_file, ft->lang, binary);
+			g_free(command);
+		}
 		symbols_finalize(); /* free c_tags_ignore data */
 		if (! status)
 		{
@@ -1791,14 +1855,20 @@ static void load_user_tags(GeanyFiletypeID ft_id)
 static void on_goto_popup_item_activate(GtkMenuItem *item, TMTag *tag)
 {
 	GeanyDocument *new_doc, *old_doc;
+	gchar *file_name;
+	gulong line;
 
 	g_return_if_fail(tag);
 
+	/* opening the file can replace its tags, freeing tag */
+	file_name = g_strdup(tag->file->file_name);
+	line = tag->line;
 	old_doc = document_get_current();
-	new_doc = document_open_file(tag->file->file_name, FALSE, NULL, NULL);
+	new_doc = document_open_file(file_name, FALSE, NULL, NULL);
+	g_free(file_name);
 
 	if (new_doc)
-		navqueue_goto_line(old_doc, new_doc, tag->line);
+		navqueue_goto_line(old_doc, new_doc, line);
 }
 
 
@@ -2105,15 +2175,23 @@ static gboolean goto_tag(const gchar *name, gboolean definition)
 	if (tags->len == 1)
 	{
 		GeanyDocument *new_doc;
+		gulong line;
 
 		tmtag = tags->pdata[0];
+		line = tmtag->line;
 		new_doc = document_find_by_real_path(tmtag->file->file_name);
 
 		if (!new_doc)
-			/* not found in opened document, should open */
-			new_doc = document_open_file(tmtag->file->file_name, FALSE, NULL, NULL);
+		{
+			/* not found in opened document, should open - this can replace the file's
+			 * tags, freeing tmtag */
+			gchar *file_name = g_strdup(tmtag->file->file_name);
 
-		navqueue_goto_line(old_doc, new_doc, tmtag->line);
+			new_doc = document_open_file(file_name, FALSE, NULL, NULL);
+			g_free(file_name);
+		}
+
+		navqueue_goto_line(old_doc, new_doc, line);
 	}
 	else if (tags->len > 1)
 	{
@@ -2633,6 +2711,11 @@ void symbols_init(void)
 	ui_add_config_file_menu_item(f, NULL, NULL);
 	g_free(f);
 
+	/* tags of unmodified files, to avoid parsing them again on next startup */
+	f = g_build_filename(app->configdir, "tags_cache", NULL);
+	tm_workspace_set_tags_cache_dir(f);
+	g_free(f);
+
 	g_signal_connect(geany_object, "document-save", G_CALLBACK(on_document_save), NULL);
 
 	for (i = 0; i < G_N_ELEMENTS(symbols_icons); i++)
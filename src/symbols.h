@@ -52,9 +52,14 @@ void symbols_global_tags_loaded(guint file_type_idx);
 
 GString *symbols_find_typenames_as_string(TMParserType lang, gboolean global);
 
+Sci_WordSet *symbols_typenames_ref(TMParserType lang);
+
+void symbols_typenames_unref(Sci_WordSet *word_set);
+
 gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode);
 
-gint symbols_generate_global_tags(gint argc, gchar **argv, gboolean want_preprocess);
+gint symbols_generate_global_tags(gint argc, gchar **argv, gboolean want_preprocess,
+	gboolean binary);
 
 void symbols_show_load_tags_dialog(void);
 
@@ -32,10 +32,55 @@ typedef struct {
 } CallbackUserData;
 
 
+/* The input and tag entry state of the ctags core is thread-local but the
+ * parsers themselves keep their state in static variables. Languages sharing
+ * a parser implementation therefore share a lock so only a single file per
+ * implementation is parsed at a time; other languages can be parsed in
+ * parallel. */
+static GMutex *parser_locks = NULL;
+static guint *parser_lock_index = NULL;
+
+
+static gpointer get_parser_function(TMParserType lang)
+{
+	parserDefinition *def = LanguageTable[lang];
+
+	return def->parser != NULL ? (gpointer) def->parser : (gpointer) def->parser2;
+}
+
+
+static void init_parser_locks(void)
+{
+	guint i, j;
+
+	parser_locks = g_new0(GMutex, LanguageCount);
+	parser_lock_index = g_new0(guint, LanguageCount);
+
+	for (i = 0; i < LanguageCount; i++)
+	{
+		g_mutex_init(&parser_locks[i]);
+
+		parser_lock_index[i] = i;
+		for (j = 0; j < i; j++)
+		{
+			if (get_parser_function(i) == get_parser_function(j))
+			{
+				parser_lock_index[i] = parser_lock_index[j];
+				break;
+			}
+		}
+	}
+
+	/* separate entry points but the same static variables in php.c */
+	parser_lock_index[TM_PARSER_ZEPHIR] = parser_lock_index[TM_PARSER_PHP];
+}
+
+
 void tm_ctags_init(void)
 {
 	initializeParsing();
 	installLanguageMapDefaults();
+	init_parser_locks();
 }
 
 
@@ -54,6 +99,7 @@ void tm_ctags_parse(guchar *buffer, gsize buffer_size,
 	CallbackUserData callback_data = {tag_callback, user_data};
 	gboolean retry = TRUE;
 	guint passCount = 0;
+	GMutex *parser_lock;
 
 	g_return_if_fail(buffer || file_name);
 
@@ -65,6 +111,8 @@ void tm_ctags_parse(guchar *buffer, gsize buffer_size,
 		return;
 	}
 
+	parser_lock = &parser_locks[parser_lock_index[lang]];
+	g_mutex_lock(parser_lock);
 	setTagEntryFunction(parse_callback, &callback_data);
 	while (retry && passCount < 3)
 	{
@@ -98,10 +146,11 @@ void tm_ctags_parse(guchar *buffer, gsize buffer_size,
 		else
 		{
 			g_warning("Unable to open %s", file_name);
-			return;
+			break;
 		}
 		++ passCount;
 	}
+	g_mutex_unlock(parser_lock);
 }
 
 
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <glib/gstdio.h>
 #ifdef G_OS_WIN32
 # define VC_EXTRALEAN
@@ -39,12 +40,6 @@ typedef struct
 } TMSourceFilePriv;
 
 
-typedef enum {
-	TM_FILE_FORMAT_TAGMANAGER,
-	TM_FILE_FORMAT_PIPE,
-	TM_FILE_FORMAT_CTAGS
-} TMFileFormat;
-
 /* Note: To preserve binary compatibility, it is very important
 	that you only *append* to this list ! */
 enum
@@ -66,6 +61,56 @@ enum
 	TA_POINTER
 };
 
+/* Binary tags file layout, all numbers are stored as little endian guint32:
+ *
+ * header:  magic "GEANYTMB", version, tag count, string table offset and size,
+ *          size and modification time of the parsed source file (tags cache
+ *          only, 0 otherwise)
+ * records: one TMBinaryTag per tag, sorted the same way as global tags
+ * strings: NUL-terminated strings referenced by their offset into the table;
+ *          offset 0 is an empty string standing for NULL
+ *
+ * Increment TM_BINARY_VERSION whenever the layout changes. */
+#define TM_BINARY_MAGIC "GEANYTMB"
+#define TM_BINARY_MAGIC_LEN 8
+#define TM_BINARY_VERSION 2
+
+typedef enum
+{
+	TB_VERSION,
+	TB_TAG_COUNT,
+	TB_STRINGS_OFFSET,
+	TB_STRINGS_SIZE,
+	TB_SOURCE_SIZE,
+	TB_SOURCE_MTIME,
+	TB_HEADER_FIELDS
+} TMBinaryHeaderField;
+
+#define TM_BINARY_HEADER_SIZE (TM_BINARY_MAGIC_LEN + TB_HEADER_FIELDS * sizeof(guint32))
+
+typedef struct
+{
+	guint32 name;
+	guint32 arglist;
+	guint32 scope;
+	guint32 inheritance;
+	guint32 var_type;
+	guint32 type;
+	guint32 pointer_order;
+	guint32 line;
+	guchar access;
+	guchar impl;
+	guchar local;
+	guchar padding;
+} TMBinaryTag;
+
+/* Identifies the version of the source file the cached tags were parsed from */
+typedef struct
+{
+	guint32 size;
+	guint32 mtime;
+} TMBinaryStamp;
+
 
 #define SOURCE_FILE_NEW(S) ((S) = g_slice_new(TMSourceFilePriv))
 #define SOURCE_FILE_FREE(S) g_slice_free(TMSourceFilePriv, (TMSourceFilePriv *) S)
@@ -183,20 +228,20 @@ static gboolean init_tag(TMTag *tag, TMSourceFile *file, const tagEntryInfo *tag
 	if (!tag_entry->name || type == tm_tag_undef_t)
 		return FALSE;
 
-	tag->name = g_strdup(tag_entry->name);
+	tag->name = tm_tag_intern_string(tag_entry->name);
 	tag->type = type;
 	tag->local = tag_entry->isFileScope;
 	tag->pointerOrder = 0;	/* backward compatibility (use var_type instead) */
 	tag->line = tag_entry->lineNumber;
 	if (NULL != tag_entry->extensionFields.signature)
-		tag->arglist = g_strdup(tag_entry->extensionFields.signature);
+		tag->arglist = tm_tag_intern_string(tag_entry->extensionFields.signature);
 	if ((NULL != tag_entry->extensionFields.scopeName) &&
 		(0 != tag_entry->extensionFields.scopeName[0]))
-		tag->scope = g_strdup(tag_entry->extensionFields.scopeName);
+		tag->scope = tm_tag_intern_string(tag_entry->extensionFields.scopeName);
 	if (tag_entry->extensionFields.inheritance != NULL)
-		tag->inheritance = g_strdup(tag_entry->extensionFields.inheritance);
+		tag->inheritance = tm_tag_intern_string(tag_entry->extensionFields.inheritance);
 	if (tag_entry->extensionFields.varType != NULL)
-		tag->var_type = g_strdup(tag_entry->extensionFields.varType);
+		tag->var_type = tm_tag_intern_string(tag_entry->extensionFields.varType);
 	if (tag_entry->extensionFields.access != NULL)
 		tag->access = get_tag_access(tag_entry->extensionFields.access);
 	if (tag_entry->extensionFields.implementation != NULL)
@@ -239,7 +284,7 @@ static gboolean init_tag_from_file(TMTag *tag, TMSourceFile *file, FILE *fp)
 			if (!isprint(*start))
 				return FALSE;
 			else
-				tag->name = g_strdup((gchar*)start);
+				tag->name = tm_tag_intern_string((gchar*)start);
 		}
 		else
 		{
@@ -255,19 +300,19 @@ static gboolean init_tag_from_file(TMTag *tag, TMSourceFile *file, FILE *fp)
 					tag->type = (TMTagType) atoi((gchar*)start + 1);
 					break;
 				case TA_ARGLIST:
-					tag->arglist = g_strdup((gchar*)start + 1);
+					tag->arglist = tm_tag_intern_string((gchar*)start + 1);
 					break;
 				case TA_SCOPE:
-					tag->scope = g_strdup((gchar*)start + 1);
+					tag->scope = tm_tag_intern_string((gchar*)start + 1);
 					break;
 				case TA_POINTER:
 					tag->pointerOrder = atoi((gchar*)start + 1);
 					break;
 				case TA_VARTYPE:
-					tag->var_type = g_strdup((gchar*)start + 1);
+					tag->var_type = tm_tag_intern_string((gchar*)start + 1);
 					break;
 				case TA_INHERITS:
-					tag->inheritance = g_strdup((gchar*)start + 1);
+					tag->inheritance = tm_tag_intern_string((gchar*)start + 1);
 					break;
 				case TA_TIME:  /* Obsolete */
 					break;
@@ -325,10 +370,10 @@ static gboolean init_tag_from_file_alt(TMTag *tag, TMSourceFile *file, FILE *fp)
 			fields = g_strsplit((gchar*)start, "|", -1);
 			field_len = g_strv_length(fields);
 
-			if (field_len >= 1) tag->name = g_strdup(fields[0]);
+			if (field_len >= 1) tag->name = tm_tag_intern_string(fields[0]);
 			else tag->name = NULL;
-			if (field_len >= 2 && fields[1] != NULL) tag->var_type = g_strdup(fields[1]);
-			if (field_len >= 3 && fields[2] != NULL) tag->arglist = g_strdup(fields[2]);
+			if (field_len >= 2 && fields[1] != NULL) tag->var_type = tm_tag_intern_string(fields[1]);
+			if (field_len >= 3 && fields[2] != NULL) tag->arglist = tm_tag_intern_string(fields[2]);
 			tag->type = tm_tag_prototype_t;
 			g_strfreev(fields);
 		}
@@ -362,13 +407,14 @@ static gboolean init_tag_from_file_ctags(TMTag *tag, TMSourceFile *file, FILE *f
 	/* tag name */
 	if (! (tab = strchr(p, '\t')) || p == tab)
 		return FALSE;
-	tag->name = g_strndup(p, (gsize)(tab - p));
+	*tab = '\0';
+	tag->name = tm_tag_intern_string(p);
 	p = tab + 1;
 
 	/* tagfile, unused */
 	if (! (tab = strchr(p, '\t')))
 	{
-		g_free(tag->name);
+		tm_tag_release_string(tag->name);
 		tag->name = NULL;
 		return FALSE;
 	}
@@ -423,8 +469,8 @@ static gboolean init_tag_from_file_ctags(TMTag *tag, TMSourceFile *file, FILE *f
 			}
 			else if (0 == strcmp(key, "inherits")) /* comma-separated list of classes this class inherits from */
 			{
-				g_free(tag->inheritance);
-				tag->inheritance = g_strdup(value);
+				tm_tag_release_string(tag->inheritance);
+				tag->inheritance = tm_tag_intern_string(value);
 			}
 			else if (0 == strcmp(key, "implementation")) /* implementation limit */
 				tag->impl = get_tag_impl(value);
@@ -438,15 +484,15 @@ static gboolean init_tag_from_file_ctags(TMTag *tag, TMSourceFile *file, FILE *f
 					 0 == strcmp(key, "struct") ||
 					 0 == strcmp(key, "union")) /* Name of the class/enum/function/struct/union in which this tag is a member */
 			{
-				g_free(tag->scope);
-				tag->scope = g_strdup(value);
+				tm_tag_release_string(tag->scope);
+				tag->scope = tm_tag_intern_string(value);
 			}
 			else if (0 == strcmp(key, "file")) /* static (local) tag */
 				tag->local = TRUE;
 			else if (0 == strcmp(key, "signature")) /* arglist */
 			{
-				g_free(tag->arglist);
-				tag->arglist = g_strdup(value);
+				tm_tag_release_string(tag->arglist);
+				tag->arglist = tm_tag_intern_string(value);
 			}
 		}
 	}
@@ -471,6 +517,9 @@ static TMTag *new_tag_from_tags_file(TMSourceFile *file, FILE *fp, TMParserType
 		case TM_FILE_FORMAT_CTAGS:
 			result = init_tag_from_file_ctags(tag, file, fp, mode);
 			break;
+		case TM_FILE_FORMAT_BINARY:
+			/* binary files are read as a whole by read_binary_tags_file() */
+			break;
 	}
 
 	if (! result)
@@ -519,6 +568,96 @@ static gboolean write_tag(TMTag *tag, FILE *fp, TMTagAttrType attrs)
 		return FALSE;
 }
 
+static guint32 read_binary_uint(const gchar *data)
+{
+	guint32 val;
+
+	memcpy(&val, data, sizeof(val));
+	return GUINT32_FROM_LE(val);
+}
+
+static gchar *get_binary_string(const gchar *strings, guint32 strings_size, guint32 offset)
+{
+	if (offset == 0 || offset >= strings_size)
+		return NULL;
+	return tm_tag_intern_string(strings + offset);
+}
+
+/* Reads a tags file written in the binary format. The file is mapped into memory
+ * and the tags are created directly from the records, without any parsing.
+ * If stamp is not NULL, the file is only read if it was written with the same
+ * stamp. */
+static GPtrArray *read_binary_tags_file(const gchar *contents, gsize length, TMParserType mode,
+	const TMBinaryStamp *stamp)
+{
+	GPtrArray *file_tags;
+	const gchar *header = contents + TM_BINARY_MAGIC_LEN;
+	const gchar *strings;
+	guint32 version, tag_count, strings_offset, strings_size, i;
+
+	if (length < TM_BINARY_HEADER_SIZE)
+		return NULL;
+
+	version = read_binary_uint(header + TB_VERSION * sizeof(guint32));
+	tag_count = read_binary_uint(header + TB_TAG_COUNT * sizeof(guint32));
+	strings_offset = read_binary_uint(header + TB_STRINGS_OFFSET * sizeof(guint32));
+	strings_size = read_binary_uint(header + TB_STRINGS_SIZE * sizeof(guint32));
+
+	if (version != TM_BINARY_VERSION)
+	{
+		if (!stamp)
+			g_warning("Unsupported binary tags file version %u", version);
+		return NULL;
+	}
+	if (stamp && (stamp->size != read_binary_uint(header + TB_SOURCE_SIZE * sizeof(guint32)) ||
+		stamp->mtime != read_binary_uint(header + TB_SOURCE_MTIME * sizeof(guint32))))
+		return NULL;
+	if (tag_count > (length - TM_BINARY_HEADER_SIZE) / sizeof(TMBinaryTag) ||
+		strings_offset < TM_BINARY_HEADER_SIZE + tag_count * sizeof(TMBinaryTag) ||
+		strings_offset > length || strings_size == 0 || strings_size > length - strings_offset ||
+		contents[strings_offset + strings_size - 1] != '\0')
+	{
+		g_warning("Corrupted binary tags file");
+		return NULL;
+	}
+
+	strings = contents + strings_offset;
+	file_tags = g_ptr_array_sized_new(tag_count);
+	for (i = 0; i < tag_count; i++)
+	{
+		const gchar *rec = contents + TM_BINARY_HEADER_SIZE + i * sizeof(TMBinaryTag);
+		TMTag *tag = tm_tag_new();
+
+		tag->name = get_binary_string(strings, strings_size,
+			read_binary_uint(rec + G_STRUCT_OFFSET(TMBinaryTag, name)));
+		if (tag->name == NULL)
+		{
+			tm_tag_unref(tag);
+			continue;
+		}
+		tag->arglist = get_binary_string(strings, strings_size,
+			read_binary_uint(rec + G_STRUCT_OFFSET(TMBinaryTag, arglist)));
+		tag->scope = get_binary_string(strings, strings_size,
+			read_binary_uint(rec + G_STRUCT_OFFSET(TMBinaryTag, scope)));
+		tag->inheritance = get_binary_string(strings, strings_size,
+			read_binary_uint(rec + G_STRUCT_OFFSET(TMBinaryTag, inheritance)));
+		tag->var_type = get_binary_string(strings, strings_size,
+			read_binary_uint(rec + G_STRUCT_OFFSET(TMBinaryTag, var_type)));
+		tag->type = read_binary_uint(rec + G_STRUCT_OFFSET(TMBinaryTag, type));
+		tag->pointerOrder = read_binary_uint(rec + G_STRUCT_OFFSET(TMBinaryTag, pointer_order));
+		tag->line = read_binary_uint(rec + G_STRUCT_OFFSET(TMBinaryTag, line));
+		tag->access = rec[G_STRUCT_OFFSET(TMBinaryTag, access)];
+		tag->impl = rec[G_STRUCT_OFFSET(TMBinaryTag, impl)];
+		tag->local = rec[G_STRUCT_OFFSET(TMBinaryTag, local)];
+		tag->lang = mode;
+		g_ptr_array_add(file_tags, tag);
+	}
+
+	return file_tags;
+}
+
+/* Reads tags from a tags file. Binary tags files are detected by their magic
+ * number, the format of text files by their first line. */
 GPtrArray *tm_source_file_read_tags_file(const gchar *tags_file, TMParserType mode)
 {
 	guchar buf[BUFSIZ];
@@ -529,6 +668,22 @@ GPtrArray *tm_source_file_read_tags_file(const gchar *tags_file, TMParserType mo
 
 	if (NULL == (fp = g_fopen(tags_file, "r")))
 		return NULL;
+	/* only map binary tags files, text ones are read line by line below */
+	if (fread(buf, 1, TM_BINARY_MAGIC_LEN, fp) == TM_BINARY_MAGIC_LEN &&
+		memcmp(buf, TM_BINARY_MAGIC, TM_BINARY_MAGIC_LEN) == 0)
+	{
+		GMappedFile *mapped;
+
+		fclose(fp);
+		mapped = g_mapped_file_new(tags_file, FALSE, NULL);
+		if (mapped == NULL)
+			return NULL;
+		file_tags = read_binary_tags_file(g_mapped_file_get_contents(mapped),
+			g_mapped_file_get_length(mapped), mode, NULL);
+		g_mapped_file_unref(mapped);
+		return file_tags;
+	}
+	rewind(fp);
 	if ((NULL == fgets((gchar*) buf, BUFSIZ, fp)) || ('\0' == *buf))
 	{
 		fclose(fp);
@@ -572,18 +727,98 @@ GPtrArray *tm_source_file_read_tags_file(const gchar *tags_file, TMParserType mo
 	return file_tags;
 }
 
-gboolean tm_source_file_write_tags_file(const gchar *tags_file, GPtrArray *tags_array)
+static guint32 add_binary_string(GString *strings, GHashTable *offsets, const gchar *str)
+{
+	gpointer offset;
+
+	if (str == NULL)
+		return 0;
+
+	if (!g_hash_table_lookup_extended(offsets, str, NULL, &offset))
+	{
+		offset = GUINT_TO_POINTER(strings->len);
+		g_string_append_len(strings, str, strlen(str) + 1);
+		g_hash_table_insert(offsets, (gpointer) str, offset);
+	}
+	return GPOINTER_TO_UINT(offset);
+}
+
+static void write_binary_uint(guint32 val, FILE *fp)
+{
+	val = GUINT32_TO_LE(val);
+	fwrite(&val, sizeof(val), 1, fp);
+}
+
+/* Writes the tags in the binary format. Identical strings are stored only once. */
+static gboolean write_binary_tags_file(FILE *fp, GPtrArray *tags_array, const TMBinaryStamp *stamp)
+{
+	GString *strings = g_string_new("");
+	GHashTable *offsets = g_hash_table_new(g_str_hash, g_str_equal);
+	guint i;
+
+	/* offset 0 is reserved for NULL strings */
+	g_string_append_c(strings, '\0');
+
+	fwrite(TM_BINARY_MAGIC, TM_BINARY_MAGIC_LEN, 1, fp);
+	write_binary_uint(TM_BINARY_VERSION, fp);
+	write_binary_uint(tags_array->len, fp);
+	write_binary_uint(TM_BINARY_HEADER_SIZE + tags_array->len * sizeof(TMBinaryTag), fp);
+	write_binary_uint(0, fp);  /* string table size, written at the end */
+	write_binary_uint(stamp ? stamp->size : 0, fp);
+	write_binary_uint(stamp ? stamp->mtime : 0, fp);
+
+	for (i = 0; i < tags_array->len; i++)
+	{
+		TMTag *tag = TM_TAG(tags_array->pdata[i]);
+		guchar chars[4] = {tag->access, tag->impl, tag->local ? 1 : 0, 0};
+
+		write_binary_uint(add_binary_string(strings, offsets, tag->name), fp);
+		write_binary_uint(add_binary_string(strings, offsets, tag->arglist), fp);
+		write_binary_uint(add_binary_string(strings, offsets, tag->scope), fp);
+		write_binary_uint(add_binary_string(strings, offsets, tag->inheritance), fp);
+		write_binary_uint(add_binary_string(strings, offsets, tag->var_type), fp);
+		write_binary_uint(tag->type, fp);
+		write_binary_uint(tag->pointerOrder, fp);
+		write_binary_uint(tag->line, fp);
+		fwrite(chars, sizeof(chars), 1, fp);
+	}
+	fwrite(strings->str, strings->len, 1, fp);
+
+	fseek(fp, TM_BINARY_MAGIC_LEN + TB_STRINGS_SIZE * sizeof(guint32), SEEK_SET);
+	write_binary_uint(strings->len, fp);
+
+	g_hash_table_destroy(offsets);
+	g_string_free(strings, TRUE);
+
+	return !ferror(fp);
+}
+
+/* Writes the tags to a tags file.
+ @param tags_file The file to write
+ @param tags_array The tags to write, usually sorted by the global tags sort attributes
+ @param format TM_FILE_FORMAT_TAGMANAGER or TM_FILE_FORMAT_BINARY
+ @return TRUE on success, FALSE on failure.
+*/
+gboolean tm_source_file_write_tags_file(const gchar *tags_file, GPtrArray *tags_array,
+	TMFileFormat format)
 {
 	guint i;
 	FILE *fp;
 	gboolean ret = TRUE;
 
 	g_return_val_if_fail(tags_array && tags_file, FALSE);
+	g_return_val_if_fail(format == TM_FILE_FORMAT_TAGMANAGER || format == TM_FILE_FORMAT_BINARY, FALSE);
 
-	fp = g_fopen(tags_file, "w");
+	fp = g_fopen(tags_file, format == TM_FILE_FORMAT_BINARY ? "wb" : "w");
 	if (!fp)
 		return FALSE;
 
+	if (format == TM_FILE_FORMAT_BINARY)
+	{
+		ret = write_binary_tags_file(fp, tags_array, NULL);
+		return (fclose(fp) == 0) && ret;
+	}
+
 	fprintf(fp, "# format=tagmanager\n");
 	for (i = 0; i < tags_array->len; i++)
 	{
@@ -601,8 +836,155 @@ gboolean tm_source_file_write_tags_file(const gchar *tags_file, GPtrArray *tags_
 	return ret;
 }
 
+/* Returns the name of the cache file of source_file inside cache_dir. The
+ * language is part of the name so that changing the filetype of a file doesn't
+ * bring back tags of the previous language, and the Geany version because the
+ * parsers of another version may produce different tags from the same file.
+ * Files cached by other versions are left to tm_workspace_set_tags_cache_dir()
+ * to remove once they are no longer used. */
+static gchar *get_cache_file_name(TMSourceFile *source_file, const gchar *cache_dir)
+{
+	gchar *key, *checksum, *name, *path;
+
+	key = g_strdup_printf("%s:%u:%s:%s", VERSION, TM_BINARY_VERSION,
+		tm_source_file_get_lang_name(source_file->lang), source_file->file_name);
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_MD5, key, -1);
+	name = g_strconcat(checksum, ".tags", NULL);
+	path = g_build_filename(cache_dir, name, NULL);
+
+	g_free(name);
+	g_free(checksum);
+	g_free(key);
+	return path;
+}
+
+static gboolean get_source_file_stamp(TMSourceFile *source_file, TMBinaryStamp *stamp)
+{
+	GStatBuf st;
+
+	if (g_stat(source_file->file_name, &st) != 0)
+		return FALSE;
+
+	stamp->size = (guint32) st.st_size;
+	stamp->mtime = (guint32) st.st_mtime;
+	return TRUE;
+}
+
+/* Reads the tags of source_file stored in cache_dir by tm_source_file_write_cached_tags().
+ @param source_file The source file whose tags to read.
+ @param cache_dir The tags cache directory.
+ @param mtime The modification time of the file version whose tags are wanted, e.g. the
+ version loaded into a document, or -1 for the file on disk.
+ @param size The size of that file version, ignored if mtime is -1.
+ @return The tags sorted the same way as when they were written, or NULL if
+ there are no cached tags or they were written for another version of the file.
+*/
+GPtrArray *tm_source_file_read_cached_tags(TMSourceFile *source_file, const gchar *cache_dir,
+	time_t mtime, gsize size)
+{
+	TMBinaryStamp stamp;
+	GMappedFile *mapped;
+	GPtrArray *tags_array = NULL;
+	gchar *cache_file;
+
+	g_return_val_if_fail(source_file != NULL && cache_dir != NULL, NULL);
+
+	if (source_file->lang == TM_PARSER_NONE)
+		return NULL;
+	if (mtime != -1)
+	{
+		stamp.size = (guint32) size;
+		stamp.mtime = (guint32) mtime;
+	}
+	else if (!get_source_file_stamp(source_file, &stamp))
+		return NULL;
+
+	cache_file = get_cache_file_name(source_file, cache_dir);
+	mapped = g_mapped_file_new(cache_file, FALSE, NULL);
+	g_free(cache_file);
+	if (!mapped)
+		return NULL;
+
+	if (g_mapped_file_get_length(mapped) >= TM_BINARY_MAGIC_LEN &&
+		memcmp(g_mapped_file_get_contents(mapped), TM_BINARY_MAGIC, TM_BINARY_MAGIC_LEN) == 0)
+	{
+		tags_array = read_binary_tags_file(g_mapped_file_get_contents(mapped),
+			g_mapped_file_get_length(mapped), source_file->lang, &stamp);
+	}
+	g_mapped_file_unref(mapped);
+
+	if (tags_array)
+	{
+		guint i;
+
+		for (i = 0; i < tags_array->len; i++)
+			TM_TAG(tags_array->pdata[i])->file = source_file;
+	}
+	return tags_array;
+}
+
+/* Stores the tags of source_file in cache_dir so they can be read by
+ tm_source_file_read_cached_tags() instead of parsing the file again as long as
+ the file doesn't change. The tags must have been parsed from the file on disk.
+ @param source_file The source file whose tags to write.
+ @param cache_dir The tags cache directory, created if it doesn't exist.
+ @return TRUE on success, FALSE on failure.
+*/
+gboolean tm_source_file_write_cached_tags(TMSourceFile *source_file, const gchar *cache_dir)
+{
+	TMBinaryStamp stamp;
+	gchar *cache_file, *tmp_file;
+	gboolean ret = FALSE;
+	FILE *fp = NULL;
+	gint fd;
+
+	g_return_val_if_fail(source_file != NULL && cache_dir != NULL, FALSE);
+
+	if (source_file->lang == TM_PARSER_NONE || !source_file->tags_array ||
+		!get_source_file_stamp(source_file, &stamp))
+		return FALSE;
+
+	if (g_mkdir_with_parents(cache_dir, 0700) != 0)
+		return FALSE;
+
+	/* write to a temporary file first so that readers never see a partial file;
+	 * its name is unique as several threads and instances may write the same file */
+	cache_file = get_cache_file_name(source_file, cache_dir);
+	tmp_file = g_strconcat(cache_file, ".XXXXXX", NULL);
+	fd = g_mkstemp(tmp_file);
+	if (fd != -1)
+	{
+		fp = fdopen(fd, "wb");
+		if (!fp)
+		{
+			close(fd);
+			g_unlink(tmp_file);
+		}
+	}
+	if (fp)
+	{
+		ret = write_binary_tags_file(fp, source_file->tags_array, &stamp);
+		ret = (fclose(fp) == 0) && ret;
+		ret = ret && g_rename(tmp_file, cache_file) == 0;
+		if (!ret)
+			g_unlink(tmp_file);
+	}
+
+	g_free(tmp_file);
+	g_free(cache_file);
+	return ret;
+}
+
+/* Target of a single parsing run - the tags are created for source_file but
+ * stored in tags_array which need not be source_file->tags_array */
+typedef struct
+{
+	TMSourceFile *source_file;
+	GPtrArray *tags_array;
+} TMParseTarget;
+
 /* add argument list of __init__() Python methods to the class tag */
-static void update_python_arglist(const TMTag *tag, TMSourceFile *current_source_file)
+static void update_python_arglist(const TMTag *tag, GPtrArray *tags_array)
 {
 	guint i;
 	const char *parent_tag_name;
@@ -618,13 +1000,13 @@ static void update_python_arglist(const TMTag *tag, TMSourceFile *current_source
 		parent_tag_name = tag->scope;
 
 	/* going in reverse order because the tag was added recently */
-	for (i = current_source_file->tags_array->len; i > 0; i--)
+	for (i = tags_array->len; i > 0; i--)
 	{
-		TMTag *prev_tag = (TMTag *) current_source_file->tags_array->pdata[i - 1];
+		TMTag *prev_tag = (TMTag *) tags_array->pdata[i - 1];
 		if (g_strcmp0(prev_tag->name, parent_tag_name) == 0)
 		{
-			g_free(prev_tag->arglist);
-			prev_tag->arglist = g_strdup(tag->arglist);
+			tm_tag_release_string(prev_tag->arglist);
+			prev_tag->arglist = tm_tag_intern_string(tag->arglist);
 			break;
 		}
 	}
@@ -633,9 +1015,9 @@ static void update_python_arglist(const TMTag *tag, TMSourceFile *current_source
 /* new parsing pass ctags callback function */
 static gboolean ctags_pass_start(void *user_data)
 {
-	TMSourceFile *current_source_file = user_data;
+	TMParseTarget *target = user_data;
 
-	tm_tags_array_free(current_source_file->tags_array, FALSE);
+	tm_tags_array_free(target->tags_array, FALSE);
 	return TRUE;
 }
 
@@ -643,19 +1025,19 @@ static gboolean ctags_pass_start(void *user_data)
 static gboolean ctags_new_tag(const tagEntryInfo *const tag,
 	void *user_data)
 {
-	TMSourceFile *current_source_file = user_data;
+	TMParseTarget *target = user_data;
 	TMTag *tm_tag = tm_tag_new();
 
-	if (!init_tag(tm_tag, current_source_file, tag))
+	if (!init_tag(tm_tag, target->source_file, tag))
 	{
 		tm_tag_unref(tm_tag);
 		return TRUE;
 	}
 
 	if (tm_tag->lang == TM_PARSER_PYTHON)
-		update_python_arglist(tm_tag, current_source_file);
+		update_python_arglist(tm_tag, target->tags_array);
 
-	g_ptr_array_add(current_source_file->tags_array, tm_tag);
+	g_ptr_array_add(target->tags_array, tm_tag);
 
 	return TRUE;
 }
@@ -724,7 +1106,8 @@ TMSourceFile *tm_source_file_new(const char *file_name, const char *name)
 }
 
 
-static TMSourceFile *tm_source_file_dup(TMSourceFile *source_file)
+/* Adds a reference to @a source_file. Drop it again with tm_source_file_free(). */
+TMSourceFile *tm_source_file_dup(TMSourceFile *source_file)
 {
 	TMSourceFilePriv *priv = (TMSourceFilePriv *) source_file;
 
@@ -792,6 +1175,7 @@ gboolean tm_source_file_parse(TMSourceFile *source_file, guchar* text_buf, gsize
 	gboolean retry = TRUE;
 	gboolean parse_file = FALSE;
 	gboolean free_buf = FALSE;
+	TMParseTarget target;
 
 	if ((NULL == source_file) || (NULL == source_file->file_name))
 	{
@@ -836,14 +1220,44 @@ gboolean tm_source_file_parse(TMSourceFile *source_file, guchar* text_buf, gsize
 
 	tm_tags_array_free(source_file->tags_array, FALSE);
 
+	target.source_file = source_file;
+	target.tags_array = source_file->tags_array;
 	tm_ctags_parse(parse_file ? NULL : text_buf, buf_size, file_name,
-		source_file->lang, ctags_new_tag, ctags_pass_start, source_file);
+		source_file->lang, ctags_new_tag, ctags_pass_start, &target);
 
 	if (free_buf)
 		g_free(text_buf);
 	return !retry;
 }
 
+/* Parses the text buffer into a newly allocated tags array without touching
+ source_file->tags_array. The tags belong to source_file but are owned by the
+ returned array. Because the source file itself isn't modified, this function
+ can be called from a worker thread while the source file is used elsewhere.
+ @param source_file The source file the buffer belongs to
+ @param text_buf The text buffer to parse
+ @param buf_size The size of text_buf.
+ @return The unsorted array of parsed tags, free it with tm_tags_array_free().
+*/
+GPtrArray *tm_source_file_parse_buffer(TMSourceFile *source_file, guchar* text_buf,
+	gsize buf_size)
+{
+	TMParseTarget target;
+
+	g_return_val_if_fail(source_file != NULL && source_file->file_name != NULL, NULL);
+
+	target.source_file = source_file;
+	target.tags_array = g_ptr_array_new();
+
+	if (source_file->lang != TM_PARSER_NONE && text_buf != NULL && buf_size != 0)
+	{
+		tm_ctags_parse(text_buf, buf_size, source_file->file_name,
+			source_file->lang, ctags_new_tag, ctags_pass_start, &target);
+	}
+
+	return target.tags_array;
+}
+
 /* Gets the name associated with the language index.
  @param lang The language index.
  @return The language name, or NULL.
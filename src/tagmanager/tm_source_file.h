@@ -46,16 +46,35 @@ gchar *tm_get_real_path(const gchar *file_name);
 
 #ifdef GEANY_PRIVATE
 
+/* Tags file formats */
+typedef enum {
+	TM_FILE_FORMAT_TAGMANAGER,
+	TM_FILE_FORMAT_PIPE,
+	TM_FILE_FORMAT_CTAGS,
+	TM_FILE_FORMAT_BINARY /* memory-mappable, see tm_source_file.c */
+} TMFileFormat;
+
 const gchar *tm_source_file_get_lang_name(TMParserType lang);
 
 TMParserType tm_source_file_get_named_lang(const gchar *name);
 
+TMSourceFile *tm_source_file_dup(TMSourceFile *source_file);
+
 gboolean tm_source_file_parse(TMSourceFile *source_file, guchar* text_buf, gsize buf_size,
 	gboolean use_buffer);
 
+GPtrArray *tm_source_file_parse_buffer(TMSourceFile *source_file, guchar* text_buf,
+	gsize buf_size);
+
 GPtrArray *tm_source_file_read_tags_file(const gchar *tags_file, TMParserType mode);
 
-gboolean tm_source_file_write_tags_file(const gchar *tags_file, GPtrArray *tags_array);
+gboolean tm_source_file_write_tags_file(const gchar *tags_file, GPtrArray *tags_array,
+	TMFileFormat format);
+
+GPtrArray *tm_source_file_read_cached_tags(TMSourceFile *source_file, const gchar *cache_dir,
+	time_t mtime, gsize size);
+
+gboolean tm_source_file_write_cached_tags(TMSourceFile *source_file, const gchar *cache_dir);
 
 #endif /* GEANY_PRIVATE */
 
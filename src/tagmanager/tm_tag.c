@@ -94,6 +94,79 @@ GType tm_tag_get_type(void)
 	return gtype;
 }
 
+/* Tag strings are interned: all tags share a single copy of each distinct
+ * name, scope, type, etc. The reference count is stored right in front of the
+ * string data so that releasing a string doesn't need a lookup. Tags are
+ * created from several parsing threads, hence the lock. */
+typedef struct
+{
+	guint refcount;
+	gchar str[1];
+} TMTagString;
+
+#define TAG_STRING(s)	((TMTagString *) ((s) - G_STRUCT_OFFSET(TMTagString, str)))
+
+static GHashTable *tag_strings = NULL;
+static GMutex tag_strings_lock;
+
+
+/*
+ Returns the interned copy of a string, adding a reference to it. Strings
+ obtained this way must not be modified and must be released with
+ tm_tag_release_string().
+ @param str The string to intern, or NULL
+ @return the shared copy of @a str, or NULL if @a str is NULL
+*/
+gchar *tm_tag_intern_string(const gchar *str)
+{
+	TMTagString *tstr;
+
+	if (str == NULL)
+		return NULL;
+
+	g_mutex_lock(&tag_strings_lock);
+	if (G_UNLIKELY(tag_strings == NULL))
+		tag_strings = g_hash_table_new(g_str_hash, g_str_equal);
+
+	tstr = g_hash_table_lookup(tag_strings, str);
+	if (tstr == NULL)
+	{
+		gsize len = strlen(str);
+
+		tstr = g_malloc(G_STRUCT_OFFSET(TMTagString, str) + len + 1);
+		tstr->refcount = 0;
+		memcpy(tstr->str, str, len + 1);
+		g_hash_table_insert(tag_strings, tstr->str, tstr);
+	}
+	tstr->refcount++;
+	g_mutex_unlock(&tag_strings_lock);
+
+	return tstr->str;
+}
+
+/*
+ Drops a reference from a string returned by tm_tag_intern_string(), freeing
+ it when no tag uses it anymore.
+ @param str The interned string, or NULL
+*/
+void tm_tag_release_string(gchar *str)
+{
+	TMTagString *tstr;
+
+	if (str == NULL)
+		return;
+
+	tstr = TAG_STRING(str);
+	g_mutex_lock(&tag_strings_lock);
+	if (--tstr->refcount == 0)
+	{
+		g_hash_table_remove(tag_strings, tstr->str);
+		g_free(tstr);
+	}
+	g_mutex_unlock(&tag_strings_lock);
+}
+
+
 /*
  Creates a new tag structure and returns a pointer to it.
  @return the new TMTag structure. This should be free()-ed using tm_tag_free()
@@ -115,11 +188,11 @@ TMTag *tm_tag_new(void)
 */
 static void tm_tag_destroy(TMTag *tag)
 {
-	g_free(tag->name);
-	g_free(tag->arglist);
-	g_free(tag->scope);
-	g_free(tag->inheritance);
-	g_free(tag->var_type);
+	tm_tag_release_string(tag->name);
+	tm_tag_release_string(tag->arglist);
+	tm_tag_release_string(tag->scope);
+	tm_tag_release_string(tag->inheritance);
+	tm_tag_release_string(tag->var_type);
 }
 
 
@@ -150,6 +223,15 @@ TMTag *tm_tag_ref(TMTag *tag)
 	return tag;
 }
 
+/* Compares two tag strings, NULL being equal to "". Interned strings can be
+ * compared by their pointers, which avoids most strcmp() calls when sorting. */
+static gint tag_strcmp(const gchar *s1, const gchar *s2)
+{
+	if (s1 == s2)
+		return 0;
+	return strcmp(FALLBACK(s1, ""), FALLBACK(s2, ""));
+}
+
 /*
  Inbuilt tag comparison function.
 */
@@ -171,7 +253,7 @@ static gint tm_tag_compare(gconstpointer ptr1, gconstpointer ptr2, gpointer user
 		if (sort_options->partial)
 			return strncmp(FALLBACK(t1->name, ""), FALLBACK(t2->name, ""), strlen(FALLBACK(t1->name, "")));
 		else
-			return strcmp(FALLBACK(t1->name, ""), FALLBACK(t2->name, ""));
+			return tag_strcmp(t1->name, t2->name);
 	}
 
 	for (sort_attr = sort_options->sort_attrs; returnval == 0 && *sort_attr != tm_tag_attr_none_t; ++ sort_attr)
@@ -182,7 +264,7 @@ static gint tm_tag_compare(gconstpointer ptr1, gconstpointer ptr2, gpointer user
 				if (sort_options->partial)
 					returnval = strncmp(FALLBACK(t1->name, ""), FALLBACK(t2->name, ""), strlen(FALLBACK(t1->name, "")));
 				else
-					returnval = strcmp(FALLBACK(t1->name, ""), FALLBACK(t2->name, ""));
+					returnval = tag_strcmp(t1->name, t2->name);
 				break;
 			case tm_tag_attr_file_t:
 				returnval = t1->file - t2->file;
@@ -194,10 +276,10 @@ static gint tm_tag_compare(gconstpointer ptr1, gconstpointer ptr2, gpointer user
 				returnval = t1->type - t2->type;
 				break;
 			case tm_tag_attr_scope_t:
-				returnval = strcmp(FALLBACK(t1->scope, ""), FALLBACK(t2->scope, ""));
+				returnval = tag_strcmp(t1->scope, t2->scope);
 				break;
 			case tm_tag_attr_arglist_t:
-				returnval = strcmp(FALLBACK(t1->arglist, ""), FALLBACK(t2->arglist, ""));
+				returnval = tag_strcmp(t1->arglist, t2->arglist);
 				if (returnval != 0)
 				{
 					int line_diff = (t1->line - t2->line);
@@ -206,7 +288,7 @@ static gint tm_tag_compare(gconstpointer ptr1, gconstpointer ptr2, gpointer user
 				}
 				break;
 			case tm_tag_attr_vartype_t:
-				returnval = strcmp(FALLBACK(t1->var_type, ""), FALLBACK(t2->var_type, ""));
+				returnval = tag_strcmp(t1->var_type, t2->var_type);
 				break;
 		}
 	}
@@ -220,17 +302,17 @@ gboolean tm_tags_equal(const TMTag *a, const TMTag *b)
 
 	return (a->line == b->line &&
 			a->file == b->file /* ptr comparison */ &&
-			strcmp(FALLBACK(a->name, ""), FALLBACK(b->name, "")) == 0 &&
+			tag_strcmp(a->name, b->name) == 0 &&
 			a->type == b->type &&
 			a->local == b->local &&
 			a->pointerOrder == b->pointerOrder &&
 			a->access == b->access &&
 			a->impl == b->impl &&
 			a->lang == b->lang &&
-			strcmp(FALLBACK(a->scope, ""), FALLBACK(b->scope, "")) == 0 &&
-			strcmp(FALLBACK(a->arglist, ""), FALLBACK(b->arglist, "")) == 0 &&
-			strcmp(FALLBACK(a->inheritance, ""), FALLBACK(b->inheritance, "")) == 0 &&
-			strcmp(FALLBACK(a->var_type, ""), FALLBACK(b->var_type, "")) == 0);
+			tag_strcmp(a->scope, b->scope) == 0 &&
+			tag_strcmp(a->arglist, b->arglist) == 0 &&
+			tag_strcmp(a->inheritance, b->inheritance) == 0 &&
+			tag_strcmp(a->var_type, b->var_type) == 0);
 }
 
 /*
@@ -244,7 +326,10 @@ void tm_tags_prune(GPtrArray *tags_array)
 
 	g_return_if_fail(tags_array);
 
-	for (i=0, count = 0; i < tags_array->len; ++i)
+	/* the part before the first removed tag stays where it is */
+	for (i = 0; i < tags_array->len && NULL != tags_array->pdata[i]; ++i)
+		;
+	for (count = i; i < tags_array->len; ++i)
 	{
 		if (NULL != tags_array->pdata[i])
 			tags_array->pdata[count++] = tags_array->pdata[i];
@@ -282,6 +367,22 @@ void tm_tags_dedup(GPtrArray *tags_array, TMTagAttrType *sort_attributes, gboole
 	tm_tags_prune(tags_array);
 }
 
+/* Checks whether the tags are already sorted (and deduplicated if dedup is TRUE).
+ * Stops at the first tag out of order so unsorted arrays are detected quickly. */
+static gboolean tags_sorted(GPtrArray *tags_array, TMSortOptions *sort_options, gboolean dedup)
+{
+	guint i;
+
+	for (i = 1; i < tags_array->len; i++)
+	{
+		gint cmp = tm_tag_compare(&tags_array->pdata[i - 1], &tags_array->pdata[i], sort_options);
+
+		if (cmp > 0 || (dedup && cmp == 0))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 /*
  Sort an array of tags on the specified attribuites using the inbuilt comparison
  function.
@@ -303,6 +404,28 @@ void tm_tags_sort(GPtrArray *tags_array, TMTagAttrType *sort_attributes,
 		tm_tags_dedup(tags_array, sort_attributes, unref_duplicates);
 }
 
+/*
+ Sorts an array of tags like tm_tags_sort() unless it is already sorted. Use this
+ for tags which are usually sorted before they are merged, e.g. read from tags
+ files which are written sorted; checking other arrays only wastes time.
+ @param tags_array The array of tags to be sorted
+ @param sort_attributes Attributes to be sorted on (int array terminated by 0)
+ @param dedup Whether to deduplicate the sorted array
+ @param unref_duplicates Whether to unref the duplicates removed by dedup
+*/
+void tm_tags_sort_unless_sorted(GPtrArray *tags_array, TMTagAttrType *sort_attributes,
+	gboolean dedup, gboolean unref_duplicates)
+{
+	TMSortOptions sort_options;
+
+	g_return_if_fail(tags_array);
+
+	sort_options.sort_attrs = sort_attributes;
+	sort_options.partial = FALSE;
+	if (!tags_sorted(tags_array, &sort_options, dedup))
+		tm_tags_sort(tags_array, sort_attributes, dedup, unref_duplicates);
+}
+
 void tm_tags_remove_file_tags(TMSourceFile *source_file, GPtrArray *tags_array)
 {
 	guint i;
@@ -486,6 +609,78 @@ GPtrArray *tm_tags_merge(GPtrArray *big_array, GPtrArray *small_array,
 	return res_array;
 }
 
+/* Returns the index of the first tag in tags[0..len) which sorts after tag. */
+static guint find_insert_pos(gpointer *tags, guint len, gpointer tag, TMSortOptions *sort_options)
+{
+	guint l = 0, u = len;
+
+	while (l < u)
+	{
+		guint idx = (l + u) / 2;
+
+		if (tm_tag_compare(&tags[idx], &tag, sort_options) <= 0)
+			l = idx + 1;
+		else
+			u = idx;
+	}
+	return l;
+}
+
+/* Merges the sorted small_array into the sorted big_array without allocating a
+ * new array. The arrays are merged from the end: the insertion point of each
+ * small_array tag is found by binary search and the block of big_array tags
+ * behind it is moved by a single memmove(). This makes the number of comparisons
+ * O(len(small) * log(len(big))) and only the part of big_array behind the first
+ * insertion point is moved. Tags from big_array equal to merged tags are
+ * replaced by them. */
+void tm_tags_merge_in_place(GPtrArray *big_array, GPtrArray *small_array,
+	TMTagAttrType *sort_attributes, gboolean unref_duplicates)
+{
+	TMSortOptions sort_options;
+	guint old_len, end, dst, i;
+	gpointer *pdata;
+
+	g_return_if_fail(big_array && small_array);
+
+	if (small_array->len == 0)
+		return;
+
+	sort_options.sort_attrs = sort_attributes;
+	sort_options.partial = FALSE;
+
+	old_len = big_array->len;
+	g_ptr_array_set_size(big_array, old_len + small_array->len);
+	pdata = big_array->pdata;
+
+	end = old_len;  /* big_array tags in [0, end) are not placed yet */
+	dst = big_array->len;  /* result is filled in [dst, len) */
+	for (i = small_array->len; i > 0; i--)
+	{
+		gpointer tag = small_array->pdata[i - 1];
+		guint pos = find_insert_pos(pdata, end, tag, &sort_options);
+
+		dst -= end - pos;
+		memmove(&pdata[dst], &pdata[pos], (end - pos) * sizeof(gpointer));
+		end = pos;
+
+		/* remove the duplicate, keep just the newly merged value */
+		if (end > 0 && tm_tag_compare(&pdata[end - 1], &tag, &sort_options) == 0)
+		{
+			end--;
+			if (unref_duplicates)
+				tm_tag_unref(pdata[end]);
+		}
+		pdata[--dst] = tag;
+	}
+
+	/* close the gap left by removed duplicates */
+	if (dst > end)
+	{
+		memmove(&pdata[end], &pdata[dst], (big_array->len - dst) * sizeof(gpointer));
+		g_ptr_array_set_size(big_array, big_array->len - (dst - end));
+	}
+}
+
 /*
  This function will extract the tags of the specified types from an array of tags.
  The returned value is a GPtrArray which should be free-d with a call to
@@ -113,14 +113,24 @@ GType tm_tag_get_type(void) G_GNUC_CONST;
 
 TMTag *tm_tag_new(void);
 
+gchar *tm_tag_intern_string(const gchar *str);
+
+void tm_tag_release_string(gchar *str);
+
 void tm_tags_remove_file_tags(TMSourceFile *source_file, GPtrArray *tags_array);
 
 GPtrArray *tm_tags_merge(GPtrArray *big_array, GPtrArray *small_array, 
 	TMTagAttrType *sort_attributes, gboolean unref_duplicates);
 
+void tm_tags_merge_in_place(GPtrArray *big_array, GPtrArray *small_array,
+	TMTagAttrType *sort_attributes, gboolean unref_duplicates);
+
 void tm_tags_sort(GPtrArray *tags_array, TMTagAttrType *sort_attributes,
 	gboolean dedup, gboolean unref_duplicates);
 
+void tm_tags_sort_unless_sorted(GPtrArray *tags_array, TMTagAttrType *sort_attributes,
+	gboolean dedup, gboolean unref_duplicates);
+
 GPtrArray *tm_tags_extract(GPtrArray *tags_array, guint tag_types);
 
 void tm_tags_prune(GPtrArray *tags_array);
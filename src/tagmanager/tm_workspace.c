@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #ifdef HAVE_GLOB_H
 # include <glob.h>
 #endif
@@ -67,6 +68,528 @@ static TMTagType TM_GLOBAL_TYPE_MASK =
 
 static TMWorkspace *theWorkspace = NULL;
 
+/* Background parsing of source file buffers - a single worker thread is enough
+ * because only the most recent request for each file matters */
+typedef struct
+{
+	TMSourceFile *source_file;
+	guchar *text_buf;
+	gsize buf_size;
+	guint generation;
+	GPtrArray *tags_array;
+	TMWorkspaceUpdateCallback callback;
+	gpointer user_data;
+} TMUpdateJob;
+
+static GThreadPool *update_pool = NULL;
+/* source file -> generation of its most recent update request; results of
+ * older requests are stale and get discarded */
+static GHashTable *update_generations = NULL;
+static guint update_generation_counter = 0;
+
+/* Completion index - for each language the sorted distinct names of its
+ * non-anonymous tags. Prefix lookups then cost a binary search plus the number
+ * of returned names, no matter how many tags share the name or the prefix.
+ * The workspace index is updated together with the source file tags, the
+ * global one is rebuilt whenever global tags are loaded. */
+typedef struct
+{
+	gchar *name;	/* interned tag name */
+	guint64 chars;	/* set of characters in the name, see name_char_mask() */
+	TMTagType types;	/* types of the tags seen with this name */
+} TMNameEntry;
+
+typedef struct
+{
+	GArray *entries;	/* TMNameEntry sorted by strcmp() of the names */
+	GHashTable *counts;	/* name -> number of tags with the name */
+} TMNameIndex;
+
+static TMNameIndex *workspace_names[TM_PARSER_COUNT];
+static TMNameIndex *global_names[TM_PARSER_COUNT];
+
+/* Member index - scope string -> array of the tags with this scope, so that
+ * the members of a type are found without scanning all tags. Like the name
+ * indexes, the workspace one is updated with the source file tags and the
+ * global one rebuilt when global tags are loaded. */
+static GHashTable *workspace_scopes = NULL;
+static GHashTable *global_scopes = NULL;
+
+/* Typename index - for each language the number of workspace tags with each
+ * name whose type is in TM_GLOBAL_TYPE_MASK, so editors can look up whether a
+ * word is a type name while highlighting. The keys are interned names but are
+ * compared by content to allow looking up any word. Names which appear or
+ * disappear are collected in typename_changes until they are taken with
+ * tm_workspace_take_typename_changes(). */
+static GHashTable *workspace_typenames[TM_PARSER_COUNT];
+static GHashTable *typename_changes[TM_PARSER_COUNT];
+
+/* directory with the tags of unmodified source files, NULL if disabled */
+static gchar *tags_cache_dir = NULL;
+
+/* cache files not used for this long are removed, e.g. those of deleted files or
+ * written by other versions */
+#define TAGS_CACHE_MAX_AGE	(30 * 24 * 60 * 60)
+
+#define NAME_ENTRY(index, i) g_array_index((index)->entries, TMNameEntry, (i))
+
+
+/* Returns a bit set of the characters in str, ignoring the case of ASCII
+ * letters. Names whose set doesn't contain all characters of a fuzzy pattern
+ * can't match it and are skipped without looking at the name. */
+static guint64 name_char_mask(const gchar *str)
+{
+	guint64 mask = 0;
+
+	for (; *str; str++)
+	{
+		guchar c = (guchar) g_ascii_tolower(*str);
+		guint bit;
+
+		if (c >= 'a' && c <= 'z')
+			bit = c - 'a';
+		else if (c >= '0' && c <= '9')
+			bit = 26 + c - '0';
+		else
+			bit = 36 + c % 28;
+		mask |= G_GUINT64_CONSTANT(1) << bit;
+	}
+	return mask;
+}
+
+
+/* Returns the position of name in the sorted index or the position where it
+ * should be inserted */
+static guint name_index_find(TMNameIndex *index, const gchar *name)
+{
+	guint lo = 0, hi = index->entries->len;
+
+	while (lo < hi)
+	{
+		guint mid = lo + (hi - lo) / 2;
+
+		if (strcmp(NAME_ENTRY(index, mid).name, name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+static gint compare_name_entries(gconstpointer a, gconstpointer b)
+{
+	return strcmp(((const TMNameEntry *) a)->name, ((const TMNameEntry *) b)->name);
+}
+
+
+static gint compare_positions(gconstpointer a, gconstpointer b)
+{
+	guint pos_a = *(const guint *) a, pos_b = *(const guint *) b;
+
+	return pos_a < pos_b ? -1 : pos_a > pos_b;
+}
+
+
+/* Inserts new_entries, whose names aren't in the index, in a single pass from the
+ * end, so adding a batch of names moves the existing entries only once */
+static void name_index_merge_entries(TMNameIndex *index, GArray *new_entries)
+{
+	guint i = index->entries->len;
+	guint j = new_entries->len;
+	guint k = i + j;
+
+	g_array_sort(new_entries, compare_name_entries);
+	g_array_set_size(index->entries, k);
+	while (j > 0)
+	{
+		TMNameEntry *new_entry = &g_array_index(new_entries, TMNameEntry, j - 1);
+
+		if (i > 0 && strcmp(NAME_ENTRY(index, i - 1).name, new_entry->name) > 0)
+			NAME_ENTRY(index, --k) = NAME_ENTRY(index, --i);
+		else
+		{
+			NAME_ENTRY(index, --k) = *new_entry;
+			j--;
+		}
+	}
+}
+
+
+/* Removes the entries at the sorted positions in a single pass */
+static void name_index_remove_entries(TMNameIndex *index, GArray *positions)
+{
+	guint src, dst, next = 0;
+
+	dst = g_array_index(positions, guint, 0);
+	for (src = dst; src < index->entries->len; src++)
+	{
+		if (next < positions->len && src == g_array_index(positions, guint, next))
+		{
+			tm_tag_release_string(NAME_ENTRY(index, src).name);
+			next++;
+		}
+		else
+			NAME_ENTRY(index, dst++) = NAME_ENTRY(index, src);
+	}
+	g_array_set_size(index->entries, dst);
+}
+
+
+static void name_index_add_tags(TMNameIndex **indexes, GPtrArray *tags)
+{
+	GArray *new_entries[TM_PARSER_COUNT] = { NULL };
+	guint i;
+
+	/* count the tags and collect the new names... */
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+		TMNameIndex *index;
+		guint count;
+
+		if (!tag || !tag->name || tag->lang < 0 || tag->lang >= TM_PARSER_COUNT ||
+			tm_tag_is_anon(tag))
+			continue;
+
+		index = indexes[tag->lang];
+		if (!index)
+		{
+			index = g_new(TMNameIndex, 1);
+			index->entries = g_array_new(FALSE, FALSE, sizeof(TMNameEntry));
+			index->counts = g_hash_table_new(g_direct_hash, g_direct_equal);
+			indexes[tag->lang] = index;
+		}
+
+		/* names are interned so the pointer identifies the name */
+		count = GPOINTER_TO_UINT(g_hash_table_lookup(index->counts, tag->name));
+		if (count == 0)
+		{
+			TMNameEntry entry;
+
+			entry.name = tm_tag_intern_string(tag->name);
+			entry.chars = name_char_mask(tag->name);
+			entry.types = 0;
+			if (!new_entries[tag->lang])
+				new_entries[tag->lang] = g_array_new(FALSE, FALSE, sizeof(TMNameEntry));
+			g_array_append_val(new_entries[tag->lang], entry);
+		}
+		g_hash_table_insert(index->counts, tag->name, GUINT_TO_POINTER(count + 1));
+	}
+
+	/* ...add the new names at once... */
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		if (!new_entries[i])
+			continue;
+		name_index_merge_entries(indexes[i], new_entries[i]);
+		g_array_free(new_entries[i], TRUE);
+	}
+
+	/* ...and add the types of the tags to their names */
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+
+		if (!tag || !tag->name || tag->lang < 0 || tag->lang >= TM_PARSER_COUNT ||
+			tm_tag_is_anon(tag))
+			continue;
+		NAME_ENTRY(indexes[tag->lang], name_index_find(indexes[tag->lang], tag->name)).types |=
+			tag->type;
+	}
+}
+
+
+/* Removes the names of tags from the indexes. The types of the names which
+ * remain are recomputed from remaining_tags, sorted by name, if not NULL. */
+static void name_index_remove_tags(TMNameIndex **indexes, GPtrArray *tags,
+	GPtrArray *remaining_tags)
+{
+	GArray *removed[TM_PARSER_COUNT] = { NULL };
+	GPtrArray *kept = g_ptr_array_new();
+	guint i, j;
+
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+		TMNameIndex *index;
+		guint count;
+
+		if (!tag || !tag->name || tag->lang < 0 || tag->lang >= TM_PARSER_COUNT)
+			continue;
+
+		index = indexes[tag->lang];
+		count = index ? GPOINTER_TO_UINT(g_hash_table_lookup(index->counts, tag->name)) : 0;
+		if (count > 1)
+		{
+			g_hash_table_insert(index->counts, tag->name, GUINT_TO_POINTER(count - 1));
+			g_ptr_array_add(kept, tag);
+		}
+		else if (count == 1)
+		{
+			guint pos = name_index_find(index, tag->name);
+
+			g_hash_table_remove(index->counts, tag->name);
+			if (!removed[tag->lang])
+				removed[tag->lang] = g_array_new(FALSE, FALSE, sizeof(guint));
+			g_array_append_val(removed[tag->lang], pos);
+		}
+	}
+
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		if (!removed[i])
+			continue;
+		g_array_sort(removed[i], compare_positions);
+		name_index_remove_entries(indexes[i], removed[i]);
+		g_array_free(removed[i], TRUE);
+	}
+
+	/* the removed tags may have been the only ones of some type with their name */
+	for (i = 0; remaining_tags && i < kept->len; i++)
+	{
+		TMTag *tag = kept->pdata[i];
+		TMNameIndex *index = indexes[tag->lang];
+		TMTagType types = 0;
+		TMTag **found;
+		guint count;
+
+		if (!g_hash_table_lookup(index->counts, tag->name))
+			continue;
+		found = tm_tags_find(remaining_tags, tag->name, FALSE, &count);
+		for (j = 0; j < count; j++)
+		{
+			if (found[j]->lang == tag->lang)
+				types |= found[j]->type;
+		}
+		NAME_ENTRY(index, name_index_find(index, tag->name)).types = types;
+	}
+	g_ptr_array_free(kept, TRUE);
+}
+
+
+static void name_index_clear(TMNameIndex **indexes)
+{
+	guint i, j;
+
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		TMNameIndex *index = indexes[i];
+
+		if (!index)
+			continue;
+		for (j = 0; j < index->entries->len; j++)
+			tm_tag_release_string(NAME_ENTRY(index, j).name);
+		g_array_free(index->entries, TRUE);
+		g_hash_table_destroy(index->counts);
+		g_free(index);
+		indexes[i] = NULL;
+	}
+}
+
+
+/* Adds at most max_num names starting with prefix from the indexes of the
+ * languages compatible with lang */
+static void name_index_find_prefix(GPtrArray *dst, TMNameIndex **indexes,
+	const gchar *prefix, TMParserType lang, guint max_num)
+{
+	gsize prefix_len = strlen(prefix);
+	gint i;
+
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		TMNameIndex *index = indexes[i];
+		guint pos, num;
+
+		if (!index || !tm_tag_langs_compatible(lang, i))
+			continue;
+
+		pos = name_index_find(index, prefix);
+		for (num = 0; num < max_num && pos < index->entries->len; num++, pos++)
+		{
+			gchar *name = NAME_ENTRY(index, pos).name;
+
+			if (strncmp(name, prefix, prefix_len) != 0)
+				break;
+			g_ptr_array_add(dst, name);
+		}
+	}
+}
+
+
+static gboolean is_typename_tag(const TMTag *tag)
+{
+	return tag && tag->name && (tag->type & TM_GLOBAL_TYPE_MASK) &&
+		tag->lang >= 0 && tag->lang < TM_PARSER_COUNT && !tm_tag_is_anon(tag);
+}
+
+
+static void typename_changed(TMParserType lang, const gchar *name)
+{
+	if (!typename_changes[lang])
+		typename_changes[lang] = g_hash_table_new_full(g_str_hash, g_str_equal,
+			(GDestroyNotify) tm_tag_release_string, NULL);
+	if (!g_hash_table_contains(typename_changes[lang], name))
+		g_hash_table_add(typename_changes[lang], tm_tag_intern_string(name));
+}
+
+
+static void typename_index_add_tags(GHashTable **indexes, GPtrArray *tags, gboolean record)
+{
+	guint i;
+
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+		GHashTable *index;
+		guint count;
+
+		if (!is_typename_tag(tag))
+			continue;
+
+		index = indexes[tag->lang];
+		if (!index)
+		{
+			/* the keys hold a reference, released when they are removed */
+			index = g_hash_table_new(g_str_hash, g_str_equal);
+			indexes[tag->lang] = index;
+		}
+
+		count = GPOINTER_TO_UINT(g_hash_table_lookup(index, tag->name));
+		if (count == 0)
+		{
+			g_hash_table_insert(index, tm_tag_intern_string(tag->name), GUINT_TO_POINTER(1));
+			if (record)
+				typename_changed(tag->lang, tag->name);
+		}
+		else
+			g_hash_table_insert(index, tag->name, GUINT_TO_POINTER(count + 1));
+	}
+}
+
+
+static void typename_index_remove_tags(GHashTable **indexes, GPtrArray *tags)
+{
+	guint i;
+
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+		gpointer key, value;
+		guint count;
+
+		if (!is_typename_tag(tag) || !indexes[tag->lang] ||
+			!g_hash_table_lookup_extended(indexes[tag->lang], tag->name, &key, &value))
+			continue;
+
+		count = GPOINTER_TO_UINT(value);
+		if (count > 1)
+			g_hash_table_insert(indexes[tag->lang], key, GUINT_TO_POINTER(count - 1));
+		else
+		{
+			g_hash_table_remove(indexes[tag->lang], key);
+			typename_changed(tag->lang, key);
+			tm_tag_release_string(key);
+		}
+	}
+}
+
+
+/* Frees the indexes, recording the names which aren't in new_indexes as changed
+ * unless new_indexes is NULL */
+static void typename_index_clear(GHashTable **indexes, GHashTable **new_indexes)
+{
+	guint i;
+
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		GHashTableIter iter;
+		gpointer key;
+
+		if (!indexes[i])
+			continue;
+		g_hash_table_iter_init(&iter, indexes[i]);
+		while (g_hash_table_iter_next(&iter, &key, NULL))
+		{
+			if (new_indexes && (!new_indexes[i] || !g_hash_table_contains(new_indexes[i], key)))
+				typename_changed(i, key);
+			tm_tag_release_string(key);
+		}
+		g_hash_table_destroy(indexes[i]);
+		indexes[i] = NULL;
+	}
+}
+
+
+static GHashTable *scope_index_new(void)
+{
+	/* the keys are interned because the tag providing a key can be removed
+	 * before the other tags with the same scope */
+	return g_hash_table_new_full(g_str_hash, g_str_equal,
+		(GDestroyNotify) tm_tag_release_string, (GDestroyNotify) g_ptr_array_unref);
+}
+
+
+static void scope_index_add_tags(GHashTable *index, GPtrArray *tags)
+{
+	guint i;
+
+	for (i = 0; i < tags->len; i++)
+	{
+		TMTag *tag = tags->pdata[i];
+		GPtrArray *members;
+
+		if (!tag || !tag->scope || tag->scope[0] == '\0')
+			continue;
+
+		members = g_hash_table_lookup(index, tag->scope);
+		if (!members)
+		{
+			members = g_ptr_array_new();
+			g_hash_table_insert(index, tm_tag_intern_string(tag->scope), members);
+		}
+		g_ptr_array_add(members, tag);
+	}
+}
+
+
+/* Removes the tags of source_file, filtering each affected scope only once */
+static void scope_index_remove_file(GHashTable *index, TMSourceFile *source_file)
+{
+	GHashTable *filtered = g_hash_table_new(g_direct_hash, g_direct_equal);
+	guint i;
+
+	for (i = 0; i < source_file->tags_array->len; i++)
+	{
+		TMTag *tag = source_file->tags_array->pdata[i];
+		GPtrArray *members;
+		guint j, len = 0;
+
+		if (!tag->scope || tag->scope[0] == '\0')
+			continue;
+
+		members = g_hash_table_lookup(index, tag->scope);
+		if (!members || g_hash_table_contains(filtered, members))
+			continue;
+
+		for (j = 0; j < members->len; j++)
+		{
+			TMTag *member = members->pdata[j];
+
+			if (member->file != source_file)
+				members->pdata[len++] = member;
+		}
+		if (len == 0)
+			g_hash_table_remove(index, tag->scope);
+		else
+		{
+			g_ptr_array_set_size(members, len);
+			g_hash_table_add(filtered, members);
+		}
+	}
+	g_hash_table_destroy(filtered);
+}
+
 
 static gboolean tm_create_workspace(void)
 {
@@ -78,6 +601,10 @@ static gboolean tm_create_workspace(void)
 	theWorkspace->typename_array = g_ptr_array_new();
 	theWorkspace->global_typename_array = g_ptr_array_new();
 
+	update_generations = g_hash_table_new(g_direct_hash, g_direct_equal);
+	workspace_scopes = scope_index_new();
+	global_scopes = scope_index_new();
+
 	tm_ctags_init();
 	tm_parser_verify_type_mappings();
 
@@ -85,6 +612,49 @@ static gboolean tm_create_workspace(void)
 }
 
 
+/* Returns whether name is the name of a type in the workspace for a language
+ compatible with lang.
+*/
+gboolean tm_workspace_is_typename(const gchar *name, TMParserType lang)
+{
+	gint i;
+
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		if (workspace_typenames[i] && tm_tag_langs_compatible(lang, i) &&
+			g_hash_table_contains(workspace_typenames[i], name))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+/* Returns the type names of lang which were added to or removed from the workspace
+ since the last call, or NULL if there are none. Free the array with g_ptr_array_unref().
+*/
+GPtrArray *tm_workspace_take_typename_changes(TMParserType lang)
+{
+	GHashTable *changes;
+	GHashTableIter iter;
+	GPtrArray *names;
+	gpointer key;
+
+	g_return_val_if_fail(lang >= 0 && lang < TM_PARSER_COUNT, NULL);
+
+	changes = typename_changes[lang];
+	if (!changes)
+		return NULL;
+
+	names = g_ptr_array_new_full(g_hash_table_size(changes), g_free);
+	g_hash_table_iter_init(&iter, changes);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+		g_ptr_array_add(names, g_strdup(key));
+	g_hash_table_destroy(changes);
+	typename_changes[lang] = NULL;
+	return names;
+}
+
+
 /* Frees the workspace structure and all child source files. Use only when
  exiting from the main program.
 */
@@ -96,6 +666,28 @@ void tm_workspace_free(void)
 	g_message("Workspace destroyed");
 #endif
 
+	/* wait for running jobs; their results are dropped in update_job_finished() */
+	if (update_pool)
+		g_thread_pool_free(update_pool, TRUE, TRUE);
+	update_pool = NULL;
+	g_hash_table_destroy(update_generations);
+	update_generations = NULL;
+	name_index_clear(workspace_names);
+	name_index_clear(global_names);
+	typename_index_clear(workspace_typenames, NULL);
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		if (typename_changes[i])
+			g_hash_table_destroy(typename_changes[i]);
+		typename_changes[i] = NULL;
+	}
+	g_hash_table_destroy(workspace_scopes);
+	workspace_scopes = NULL;
+	g_hash_table_destroy(global_scopes);
+	global_scopes = NULL;
+	g_free(tags_cache_dir);
+	tags_cache_dir = NULL;
+
 	for (i=0; i < theWorkspace->source_files->len; ++i)
 		tm_source_file_free(theWorkspace->source_files->pdata[i]);
 	g_ptr_array_free(theWorkspace->source_files, TRUE);
@@ -122,16 +714,16 @@ const TMWorkspace *tm_get_workspace(void)
 }
 
 
-static void tm_workspace_merge_tags(GPtrArray **big_array, GPtrArray *small_array)
+/* Updates the sorted big_array in place so the cost depends on the number of
+ * merged tags rather than on the size of the workspace */
+static void tm_workspace_merge_tags(GPtrArray *big_array, GPtrArray *small_array)
 {
-	GPtrArray *new_tags = tm_tags_merge(*big_array, small_array, workspace_tags_sort_attrs, FALSE);
-	/* tags owned by TMSourceFile - free just the pointer array */
-	g_ptr_array_free(*big_array, TRUE);
-	*big_array = new_tags;
+	/* tags owned by TMSourceFile - only the pointers are moved */
+	tm_tags_merge_in_place(big_array, small_array, workspace_tags_sort_attrs, FALSE);
 }
 
 
-static void merge_extracted_tags(GPtrArray **dest, GPtrArray *src, TMTagType tag_types)
+static void merge_extracted_tags(GPtrArray *dest, GPtrArray *src, TMTagType tag_types)
 {
 	GPtrArray *arr;
 
@@ -141,6 +733,58 @@ static void merge_extracted_tags(GPtrArray **dest, GPtrArray *src, TMTagType tag
 }
 
 
+/* Removes the tags of source_file from the workspace arrays - needs to be done
+ * while they exist and can be scanned */
+static void remove_source_file_tags(TMSourceFile *source_file)
+{
+	tm_tags_remove_file_tags(source_file, theWorkspace->tags_array);
+	tm_tags_remove_file_tags(source_file, theWorkspace->typename_array);
+	typename_index_remove_tags(workspace_typenames, source_file->tags_array);
+	name_index_remove_tags(workspace_names, source_file->tags_array, theWorkspace->tags_array);
+	scope_index_remove_file(workspace_scopes, source_file);
+}
+
+
+static void add_source_file_tags(TMSourceFile *source_file)
+{
+	tm_workspace_merge_tags(theWorkspace->tags_array, source_file->tags_array);
+	merge_extracted_tags(theWorkspace->typename_array, source_file->tags_array, TM_GLOBAL_TYPE_MASK);
+	typename_index_add_tags(workspace_typenames, source_file->tags_array, TRUE);
+	name_index_add_tags(workspace_names, source_file->tags_array);
+	scope_index_add_tags(workspace_scopes, source_file->tags_array);
+}
+
+
+/* Replaces the tags of source_file by the cached ones if the file didn't change
+ * since they were cached */
+static gboolean read_cached_tags(TMSourceFile *source_file)
+{
+	GPtrArray *tags_array;
+
+	if (!tags_cache_dir)
+		return FALSE;
+
+	tags_array = tm_source_file_read_cached_tags(source_file, tags_cache_dir, -1, 0);
+	if (!tags_array)
+		return FALSE;
+
+	tm_tags_array_free(source_file->tags_array, TRUE);
+	source_file->tags_array = tags_array;
+	/* no-op unless the sort order changed since the tags were cached */
+	tm_tags_sort_unless_sorted(source_file->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+	return TRUE;
+}
+
+
+/* Stores the tags of source_file, which must have been parsed from the file on
+ * disk, in the tags cache */
+static void write_cached_tags(TMSourceFile *source_file)
+{
+	if (tags_cache_dir && !tm_source_file_write_cached_tags(source_file, tags_cache_dir))
+		g_debug("Failed to cache tags of %s", source_file->file_name);
+}
+
+
 static void update_source_file(TMSourceFile *source_file, guchar* text_buf,
 	gsize buf_size, gboolean use_buffer, gboolean update_workspace)
 {
@@ -148,23 +792,29 @@ static void update_source_file(TMSourceFile *source_file, guchar* text_buf,
 	g_message("Source file updating based on source file %s", source_file->file_name);
 #endif
 
+	/* the result of a pending background update would be older than this one */
+	g_hash_table_remove(update_generations, source_file);
+
+	/* tm_source_file_parse() deletes the tag objects - remove the tags from
+	 * workspace while they exist and can be scanned */
 	if (update_workspace)
+		remove_source_file_tags(source_file);
+
+	/* only workspace files are cached, not e.g. files for global tags */
+	if (use_buffer || !update_workspace || !read_cached_tags(source_file))
 	{
-		/* tm_source_file_parse() deletes the tag objects - remove the tags from
-		 * workspace while they exist and can be scanned */
-		tm_tags_remove_file_tags(source_file, theWorkspace->tags_array);
-		tm_tags_remove_file_tags(source_file, theWorkspace->typename_array);
+		tm_source_file_parse(source_file, text_buf, buf_size, use_buffer);
+		tm_tags_sort(source_file->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+		if (!use_buffer && update_workspace)
+			write_cached_tags(source_file);
 	}
-	tm_source_file_parse(source_file, text_buf, buf_size, use_buffer);
-	tm_tags_sort(source_file->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+
 	if (update_workspace)
 	{
 #ifdef TM_DEBUG
 		g_message("Updating workspace from source file");
 #endif
-		tm_workspace_merge_tags(&theWorkspace->tags_array, source_file->tags_array);
-
-		merge_extracted_tags(&(theWorkspace->typename_array), source_file->tags_array, TM_GLOBAL_TYPE_MASK);
+		add_source_file_tags(source_file);
 	}
 #ifdef TM_DEBUG
 	else
@@ -215,6 +865,184 @@ void tm_workspace_update_source_file_buffer(TMSourceFile *source_file, guchar* t
 }
 
 
+static void update_job_free(TMUpdateJob *job)
+{
+	if (job->tags_array)
+		tm_tags_array_free(job->tags_array, TRUE);
+	g_free(job->text_buf);
+	tm_source_file_free(job->source_file);
+	g_slice_free(TMUpdateJob, job);
+}
+
+
+/* Runs in the main thread once the worker has parsed the buffer. Replaces the
+ * source file tags by the parsed ones unless the source file was updated,
+ * removed or its update cancelled in the meantime. */
+static gboolean update_job_finished(gpointer data)
+{
+	TMUpdateJob *job = data;
+	TMSourceFile *source_file = job->source_file;
+
+	if (theWorkspace && GPOINTER_TO_UINT(g_hash_table_lookup(update_generations,
+		source_file)) == job->generation)
+	{
+		GPtrArray *old_tags = source_file->tags_array;
+
+		g_hash_table_remove(update_generations, source_file);
+
+		remove_source_file_tags(source_file);
+		source_file->tags_array = job->tags_array;
+		job->tags_array = NULL;
+		tm_tags_array_free(old_tags, TRUE);
+
+		add_source_file_tags(source_file);
+
+		if (job->callback)
+			job->callback(source_file, job->user_data);
+	}
+#ifdef TM_DEBUG
+	else
+		g_message("Discarding stale tags of %s", source_file->file_name);
+#endif
+
+	update_job_free(job);
+	return FALSE;
+}
+
+
+/* Worker thread function - parses the buffer snapshot into a private array */
+static void update_job_run(gpointer data, gpointer user_data)
+{
+	TMUpdateJob *job = data;
+
+	job->tags_array = tm_source_file_parse_buffer(job->source_file, job->text_buf, job->buf_size);
+	tm_tags_sort(job->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+	g_free(job->text_buf);
+	job->text_buf = NULL;
+
+	g_idle_add_full(G_PRIORITY_LOW, update_job_finished, job, NULL);
+}
+
+
+/* Like tm_workspace_update_source_file_buffer() but the buffer is parsed in a
+ worker thread and the workspace is updated later from the main loop. If the
+ source file is updated again, removed from the workspace or the update is
+ cancelled by tm_workspace_cancel_source_file_update() before the parsing
+ finishes, the result is discarded and the callback isn't called.
+ @param source_file The source file to update with a buffer.
+ @param text_buf A snapshot of the text buffer. Ownership is transferred to the
+ workspace which frees it with g_free() after the use.
+ @param buf_size The size of text_buf.
+ @param callback Function called in the main thread after the workspace has been updated, or NULL.
+ @param user_data User data passed to callback.
+*/
+void tm_workspace_update_source_file_buffer_async(TMSourceFile *source_file, guchar* text_buf,
+	gsize buf_size, TMWorkspaceUpdateCallback callback, gpointer user_data)
+{
+	TMUpdateJob *job;
+
+	g_return_if_fail(source_file != NULL);
+
+	if (!update_pool)
+		update_pool = g_thread_pool_new(update_job_run, NULL, 1, FALSE, NULL);
+
+	job = g_slice_new0(TMUpdateJob);
+	job->source_file = tm_source_file_dup(source_file);
+	job->text_buf = text_buf;
+	job->buf_size = buf_size;
+	job->generation = ++update_generation_counter;
+	job->callback = callback;
+	job->user_data = user_data;
+
+	g_hash_table_insert(update_generations, source_file, GUINT_TO_POINTER(job->generation));
+	g_thread_pool_push(update_pool, job, NULL);
+}
+
+
+/* Discards the result of a pending tm_workspace_update_source_file_buffer_async()
+ call, e.g. because the buffer changed since its snapshot was taken.
+ @param source_file The source file whose update should be cancelled.
+*/
+void tm_workspace_cancel_source_file_update(TMSourceFile *source_file)
+{
+	g_return_if_fail(source_file != NULL);
+
+	g_hash_table_remove(update_generations, source_file);
+}
+
+
+/* Removes the files of the tags cache which haven't been read or written for
+ * TAGS_CACHE_MAX_AGE, as well as temporary files left behind when writing failed */
+static void prune_tags_cache(const gchar *cache_dir)
+{
+	GDir *dir = g_dir_open(cache_dir, 0, NULL);
+	const gchar *name;
+	time_t now = time(NULL);
+
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name(dir)) != NULL)
+	{
+		gchar *path = g_build_filename(cache_dir, name, NULL);
+		GStatBuf st;
+
+		if (g_stat(path, &st) == 0 && S_ISREG(st.st_mode) &&
+			now - MAX(st.st_mtime, st.st_atime) > TAGS_CACHE_MAX_AGE)
+			g_unlink(path);
+		g_free(path);
+	}
+	g_dir_close(dir);
+}
+
+
+/* Sets the directory where the tags of source files parsed from disk are cached,
+ so that they needn't be parsed again until the files change. The cache is
+ used by tm_workspace_add_source_file(), tm_workspace_add_source_files() and
+ tm_workspace_update_source_file_from_cache(). Files in it which haven't been
+ used for a long time are removed.
+ @param cache_dir The cache directory, created when needed, or NULL to disable caching.
+*/
+void tm_workspace_set_tags_cache_dir(const gchar *cache_dir)
+{
+	g_free(tags_cache_dir);
+	tags_cache_dir = g_strdup(cache_dir);
+	if (tags_cache_dir)
+		prune_tags_cache(tags_cache_dir);
+}
+
+
+/* Updates the source file with the cached tags of a version of the file, e.g. the one
+ loaded into a document, which may differ from the file on disk.
+ @param source_file The source file to update.
+ @param mtime The modification time of the file version.
+ @param size The size of the file version.
+ @return TRUE if the tags were read from the cache, FALSE if the file needs parsing.
+*/
+gboolean tm_workspace_update_source_file_from_cache(TMSourceFile *source_file,
+	time_t mtime, gsize size)
+{
+	GPtrArray *tags_array;
+
+	g_return_val_if_fail(source_file != NULL, FALSE);
+
+	if (!tags_cache_dir)
+		return FALSE;
+
+	tags_array = tm_source_file_read_cached_tags(source_file, tags_cache_dir, mtime, size);
+	if (!tags_array)
+		return FALSE;
+
+	g_hash_table_remove(update_generations, source_file);
+	remove_source_file_tags(source_file);
+	tm_tags_array_free(source_file->tags_array, TRUE);
+	source_file->tags_array = tags_array;
+	tm_tags_sort_unless_sorted(source_file->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+	add_source_file_tags(source_file);
+	return TRUE;
+}
+
+
 /** Removes a source file from the workspace if it exists. This function also removes
  the tags belonging to this file from the workspace. To completely free the TMSourceFile 
  pointer call tm_source_file_free() on it.
@@ -231,8 +1059,8 @@ void tm_workspace_remove_source_file(TMSourceFile *source_file)
 	{
 		if (theWorkspace->source_files->pdata[i] == source_file)
 		{
-			tm_tags_remove_file_tags(source_file, theWorkspace->tags_array);
-			tm_tags_remove_file_tags(source_file, theWorkspace->typename_array);
+			g_hash_table_remove(update_generations, source_file);
+			remove_source_file_tags(source_file);
 			g_ptr_array_remove_index_fast(theWorkspace->source_files, i);
 			return;
 		}
@@ -249,12 +1077,15 @@ static void tm_workspace_update(void)
 {
 	guint i, j;
 	TMSourceFile *source_file;
+	GHashTable *old_typenames[TM_PARSER_COUNT];
 
 #ifdef TM_DEBUG
 	g_message("Recreating workspace tags array");
 #endif
 
 	g_ptr_array_set_size(theWorkspace->tags_array, 0);
+	name_index_clear(workspace_names);
+	g_hash_table_remove_all(workspace_scopes);
 
 #ifdef TM_DEBUG
 	g_message("Total %d objects", theWorkspace->source_files->len);
@@ -272,6 +1103,8 @@ static void tm_workspace_update(void)
 				g_ptr_array_add(theWorkspace->tags_array,
 					source_file->tags_array->pdata[j]);
 			}
+			name_index_add_tags(workspace_names, source_file->tags_array);
+			scope_index_add_tags(workspace_scopes, source_file->tags_array);
 		}
 	}
 #ifdef TM_DEBUG
@@ -281,6 +1114,62 @@ static void tm_workspace_update(void)
 
 	g_ptr_array_free(theWorkspace->typename_array, TRUE);
 	theWorkspace->typename_array = tm_tags_extract(theWorkspace->tags_array, TM_GLOBAL_TYPE_MASK);
+
+	/* only record the names which differ from the previous index */
+	memcpy(old_typenames, workspace_typenames, sizeof(workspace_typenames));
+	memset(workspace_typenames, 0, sizeof(workspace_typenames));
+	typename_index_add_tags(workspace_typenames, theWorkspace->typename_array, FALSE);
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		GHashTableIter iter;
+		gpointer key;
+
+		if (!workspace_typenames[i])
+			continue;
+		g_hash_table_iter_init(&iter, workspace_typenames[i]);
+		while (g_hash_table_iter_next(&iter, &key, NULL))
+		{
+			if (!old_typenames[i] || !g_hash_table_contains(old_typenames[i], key))
+				typename_changed(i, key);
+		}
+	}
+	typename_index_clear(old_typenames, workspace_typenames);
+}
+
+
+/* Parses the source file from disk, or reads its cached tags, without touching
+ the workspace. Thread-safe as long as the source file isn't part of the
+ workspace yet; add it with tm_workspace_add_parsed_source_files() afterwards.
+ @param source_file The source file to parse.
+*/
+void tm_workspace_parse_source_file(TMSourceFile *source_file)
+{
+	g_return_if_fail(source_file != NULL);
+
+	if (read_cached_tags(source_file))
+		return;
+
+	tm_source_file_parse(source_file, NULL, 0, FALSE);
+	tm_tags_sort(source_file->tags_array, file_tags_sort_attrs, FALSE, TRUE);
+	write_cached_tags(source_file);
+}
+
+
+/* Thread pool function parsing a single file for tm_workspace_add_source_files() */
+static void parse_source_file_job(gpointer data, gpointer user_data)
+{
+	tm_workspace_parse_source_file(data);
+}
+
+
+static guint get_parse_thread_count(guint file_count)
+{
+	guint thread_count = 1;
+
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	thread_count = g_get_num_processors();
+#endif
+	return MAX(1, MIN(thread_count, file_count));
 }
 
 
@@ -292,22 +1181,66 @@ static void tm_workspace_update(void)
 GEANY_API_SYMBOL
 void tm_workspace_add_source_files(GPtrArray *source_files)
 {
+	GThreadPool *pool;
 	guint i;
 
 	g_return_if_fail(source_files != NULL);
 
+	/* the files are independent so they can be parsed in parallel, ctags takes
+	 * care of serializing files using the same parser */
+	pool = g_thread_pool_new(parse_source_file_job, NULL,
+		get_parse_thread_count(source_files->len), FALSE, NULL);
+
 	for (i = 0; i < source_files->len; i++)
 	{
 		TMSourceFile *source_file = source_files->pdata[i];
 		
 		tm_workspace_add_source_file_noupdate(source_file);
-		update_source_file(source_file, NULL, 0, FALSE, FALSE);
+		g_hash_table_remove(update_generations, source_file);
+		g_thread_pool_push(pool, source_file, NULL);
 	}
+	/* wait until all files are parsed */
+	g_thread_pool_free(pool, FALSE, TRUE);
 	
 	tm_workspace_update();
 }
 
 
+/* Adds source files already parsed by tm_workspace_parse_source_file() to the
+ workspace. Unlike tm_workspace_add_source_files() the tags are merged into the
+ existing workspace arrays so adding a batch of files to a big workspace
+ doesn't rebuild the whole workspace.
+ @param source_files @elementtype{TMSourceFile} The parsed source files to add.
+*/
+void tm_workspace_add_parsed_source_files(GPtrArray *source_files)
+{
+	GPtrArray *new_tags;
+	guint i, j;
+
+	g_return_if_fail(source_files != NULL);
+
+	new_tags = g_ptr_array_new();
+	for (i = 0; i < source_files->len; i++)
+	{
+		TMSourceFile *source_file = source_files->pdata[i];
+
+		tm_workspace_add_source_file_noupdate(source_file);
+		g_hash_table_remove(update_generations, source_file);
+		for (j = 0; j < source_file->tags_array->len; j++)
+			g_ptr_array_add(new_tags, source_file->tags_array->pdata[j]);
+		name_index_add_tags(workspace_names, source_file->tags_array);
+		scope_index_add_tags(workspace_scopes, source_file->tags_array);
+	}
+
+	/* a single merge of all the new tags is cheaper than one merge per file */
+	tm_tags_sort(new_tags, workspace_tags_sort_attrs, TRUE, FALSE);
+	tm_workspace_merge_tags(theWorkspace->tags_array, new_tags);
+	merge_extracted_tags(theWorkspace->typename_array, new_tags, TM_GLOBAL_TYPE_MASK);
+	typename_index_add_tags(workspace_typenames, new_tags, TRUE);
+	g_ptr_array_free(new_tags, TRUE);
+}
+
+
 /** Removes multiple source files from the workspace and updates the workspace tag
  arrays. This is more efficient than calling tm_workspace_remove_source_file()
  separately for each of the files. To completely free the TMSourceFile pointers
@@ -330,6 +1263,7 @@ void tm_workspace_remove_source_files(GPtrArray *source_files)
 		{
 			if (theWorkspace->source_files->pdata[j] == source_file)
 			{
+				g_hash_table_remove(update_generations, source_file);
 				g_ptr_array_remove_index_fast(theWorkspace->source_files, j);
 				break;
 			}
@@ -354,7 +1288,8 @@ gboolean tm_workspace_load_global_tags(const char *tags_file, TMParserType mode)
 	if (!file_tags)
 		return FALSE;
 
-	tm_tags_sort(file_tags, global_tags_sort_attrs, TRUE, TRUE);
+	/* tags files are written sorted, don't sort them again when loading */
+	tm_tags_sort_unless_sorted(file_tags, global_tags_sort_attrs, TRUE, TRUE);
 
 	/* reorder the whole array, because tm_tags_find expects a sorted array */
 	new_tags = tm_tags_merge(theWorkspace->global_tags, 
@@ -366,6 +1301,12 @@ gboolean tm_workspace_load_global_tags(const char *tags_file, TMParserType mode)
 	g_ptr_array_free(theWorkspace->global_typename_array, TRUE);
 	theWorkspace->global_typename_array = tm_tags_extract(new_tags, TM_GLOBAL_TYPE_MASK);
 
+	/* duplicates of already loaded tags were dropped by the merge */
+	name_index_clear(global_names);
+	name_index_add_tags(global_names, new_tags);
+	g_hash_table_remove_all(global_scopes);
+	scope_index_add_tags(global_scopes, new_tags);
+
 	return TRUE;
 }
 
@@ -599,10 +1540,11 @@ static gchar *pre_process_file(const gchar *cmd, const gchar *inf)
  are allowed.
  @param tags_file The file where the tags will be stored.
  @param lang The language to use for the tags file.
+ @param binary Whether to write the tags in the binary format instead of the text format.
  @return TRUE on success, FALSE on failure.
 */
 gboolean tm_workspace_create_global_tags(const char *pre_process, const char **includes,
-	int includes_count, const char *tags_file, TMParserType lang)
+	int includes_count, const char *tags_file, TMParserType lang, gboolean binary)
 {
 	gboolean ret = FALSE;
 	TMSourceFile *source_file;
@@ -652,7 +1594,8 @@ gboolean tm_workspace_create_global_tags(const char *pre_process, const char **i
 	}
 
 	tm_tags_sort(source_file->tags_array, global_tags_sort_attrs, TRUE, FALSE);
-	ret = tm_source_file_write_tags_file(tags_file, source_file->tags_array);
+	ret = tm_source_file_write_tags_file(tags_file, source_file->tags_array,
+		binary ? TM_FILE_FORMAT_BINARY : TM_FILE_FORMAT_TAGMANAGER);
 	tm_source_file_free(source_file);
 
 cleanup:
@@ -662,6 +1605,33 @@ cleanup:
 }
 
 
+/* Writes the tags of an existing tags file to another one, e.g. to convert a
+ text tags file to the binary format or back.
+ @param in_file The tags file to read, in any format tm_source_file_read_tags_file() reads.
+ @param tags_file The file where the tags will be stored.
+ @param lang The language of the tags.
+ @param binary Whether to write the tags in the binary format instead of the text format.
+ @return TRUE on success, FALSE on failure.
+*/
+gboolean tm_workspace_convert_global_tags(const char *in_file, const char *tags_file,
+	TMParserType lang, gboolean binary)
+{
+	GPtrArray *tags = tm_source_file_read_tags_file(in_file, lang);
+	gboolean ret = FALSE;
+
+	if (!tags)
+		return FALSE;
+	if (tags->len > 0)
+	{
+		tm_tags_sort_unless_sorted(tags, global_tags_sort_attrs, TRUE, TRUE);
+		ret = tm_source_file_write_tags_file(tags_file, tags,
+			binary ? TM_FILE_FORMAT_BINARY : TM_FILE_FORMAT_TAGMANAGER);
+	}
+	tm_tags_array_free(tags, TRUE);
+	return ret;
+}
+
+
 static void fill_find_tags_array(GPtrArray *dst, const GPtrArray *src,
 	const char *name, const char *scope, TMTagType type, TMParserType lang)
 {
@@ -709,29 +1679,25 @@ GPtrArray *tm_workspace_find(const char *name, const char *scope, TMTagType type
 }
 
 
-static void fill_find_tags_array_prefix(GPtrArray *dst, const GPtrArray *src,
-	const char *name, TMParserType lang, guint max_num)
+/* Returns the first tag called name usable for lang from the sorted tags array */
+static TMTag *find_prefix_tag(const GPtrArray *tags_array, const gchar *name, TMParserType lang)
 {
-	TMTag **tag, *last = NULL;
-	guint i, count, num;
-
-	if (!src || !dst || !name || !*name)
-		return;
+	TMTag **tag;
+	guint i, count;
 
-	num = 0;
-	tag = tm_tags_find(src, name, TRUE, &count);
-	for (i = 0; i < count && num < max_num; ++i)
+	tag = tm_tags_find(tags_array, name, FALSE, &count);
+	for (i = 0; i < count; i++, tag++)
 	{
-		if (tm_tag_langs_compatible(lang, (*tag)->lang) &&
-			!tm_tag_is_anon(*tag) &&
-			(!last || g_strcmp0(last->name, (*tag)->name) != 0))
-		{
-			g_ptr_array_add(dst, *tag);
-			last = *tag;
-			num++;
-		}
-		tag++;
+		if (tm_tag_langs_compatible(lang, (*tag)->lang) && !tm_tag_is_anon(*tag))
+			return *tag;
 	}
+	return NULL;
+}
+
+
+static gint compare_names(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const gchar **) a, *(const gchar **) b);
 }
 
 
@@ -745,20 +1711,269 @@ static void fill_find_tags_array_prefix(GPtrArray *dst, const GPtrArray *src,
 */
 GPtrArray *tm_workspace_find_prefix(const char *prefix, TMParserType lang, guint max_num)
 {
-	TMTagAttrType attrs[] = { tm_tag_attr_name_t, 0 };
 	GPtrArray *tags = g_ptr_array_new();
+	GPtrArray *names;
+	const gchar *last = NULL;
+	guint i;
 
-	fill_find_tags_array_prefix(tags, theWorkspace->tags_array, prefix, lang, max_num);
-	fill_find_tags_array_prefix(tags, theWorkspace->global_tags, prefix, lang, max_num);
+	if (!prefix || !*prefix)
+		return tags;
 
-	tm_tags_sort(tags, attrs, TRUE, FALSE);
-	if (tags->len > max_num)
-		tags->len = max_num;
+	/* at most max_num names from each index, the smallest max_num of them win */
+	names = g_ptr_array_new();
+	name_index_find_prefix(names, workspace_names, prefix, lang, max_num);
+	name_index_find_prefix(names, global_names, prefix, lang, max_num);
+	g_ptr_array_sort(names, compare_names);
+
+	for (i = 0; i < names->len && tags->len < max_num; i++)
+	{
+		const gchar *name = names->pdata[i];
+		TMTag *tag;
+
+		if (last && strcmp(last, name) == 0)
+			continue;
+		last = name;
+
+		tag = find_prefix_tag(theWorkspace->tags_array, name, lang);
+		if (!tag)
+			tag = find_prefix_tag(theWorkspace->global_tags, name, lang);
+		if (tag)
+			g_ptr_array_add(tags, tag);
+	}
+	g_ptr_array_free(names, TRUE);
 
 	return tags;
 }
 
 
+/* Fuzzy completion scores */
+#define FUZZY_MATCH			16	/* each matched character */
+#define FUZZY_FIRST			12	/* match at the start of the name */
+#define FUZZY_BOUNDARY		8	/* match at a word start after '_' or a camelCase hump */
+#define FUZZY_CONSECUTIVE	6	/* match right after the previous one */
+#define FUZZY_CASE			1	/* case matches the pattern */
+#define FUZZY_MAX_GAP		8	/* maximum penalty for characters skipped at once */
+#define FUZZY_SAME_FILE		24	/* name defined in the current file */
+#define FUZZY_WORKSPACE		8	/* name defined in an open file rather than in global tags */
+#define FUZZY_TYPE			4	/* name of a function, macro or type */
+
+typedef struct
+{
+	const gchar *name;
+	gint score;
+} TMFuzzyMatch;
+
+
+static gboolean is_word_start(const gchar *name, guint pos)
+{
+	gchar c, prev;
+
+	if (pos == 0)
+		return TRUE;
+	c = name[pos];
+	prev = name[pos - 1];
+	return !g_ascii_isalnum(prev) ||
+		(g_ascii_isupper(c) && !g_ascii_isupper(prev)) ||
+		(g_ascii_isdigit(c) && !g_ascii_isdigit(prev));
+}
+
+
+/* Returns the score of pattern matching name as a case-insensitive subsequence,
+ * or -1 if it doesn't match. With prefer_words, the characters are matched at
+ * the start of words if possible instead of at their first occurrence, which
+ * fails for some names that the first occurrence matching accepts. */
+static gint fuzzy_score(const gchar *name, const gchar *pattern, gboolean prefer_words)
+{
+	gint score = 0;
+	gint last = -1;
+	gint i;
+
+	for (; *pattern; pattern++)
+	{
+		gchar pc = g_ascii_tolower(*pattern);
+		gint found = -1;
+
+		for (i = last + 1; name[i]; i++)
+		{
+			if (g_ascii_tolower(name[i]) != pc)
+				continue;
+			if (found < 0)
+				found = i;
+			if (!prefer_words || i == last + 1 || is_word_start(name, i))
+			{
+				found = i;
+				break;
+			}
+		}
+		if (found < 0)
+			return -1;
+
+		score += FUZZY_MATCH;
+		if (found == 0)
+			score += FUZZY_FIRST;
+		else if (is_word_start(name, found))
+			score += FUZZY_BOUNDARY;
+		if (found == last + 1 && last >= 0)
+			score += FUZZY_CONSECUTIVE;
+		else
+			score -= MIN(found - last - 1, FUZZY_MAX_GAP);
+		if (name[found] == *pattern)
+			score += FUZZY_CASE;
+		last = found;
+	}
+	/* prefer whole names, then shorter names among equally good matches */
+	if (name[last + 1] == '\0')
+		return score + FUZZY_BOUNDARY;
+	return score - MIN((gint) strlen(name + last + 1), FUZZY_MAX_GAP);
+}
+
+
+/* Inserts the match into the array of the best max_num matches sorted by score */
+static void add_fuzzy_match(GArray *matches, const gchar *name, gint score, guint max_num)
+{
+	TMFuzzyMatch match;
+	guint i;
+
+	if (matches->len >= max_num)
+	{
+		TMFuzzyMatch *worst = &g_array_index(matches, TMFuzzyMatch, matches->len - 1);
+
+		if (worst->score > score || (worst->score == score && strcmp(worst->name, name) <= 0))
+			return;
+	}
+
+	/* the name can come from several indexes, keep its best score */
+	for (i = 0; i < matches->len; i++)
+	{
+		TMFuzzyMatch *m = &g_array_index(matches, TMFuzzyMatch, i);
+
+		if (m->name == name)
+		{
+			if (m->score >= score)
+				return;
+			g_array_remove_index(matches, i);
+			break;
+		}
+	}
+
+	for (i = matches->len; i > 0; i--)
+	{
+		TMFuzzyMatch *m = &g_array_index(matches, TMFuzzyMatch, i - 1);
+
+		if (m->score > score || (m->score == score && strcmp(m->name, name) < 0))
+			break;
+	}
+	if (i >= max_num)
+		return;
+
+	match.name = name;
+	match.score = score;
+	g_array_insert_val(matches, i, match);
+	if (matches->len > max_num)
+		g_array_set_size(matches, max_num);
+}
+
+
+static void name_index_find_fuzzy(GArray *matches, TMNameIndex **indexes,
+	const gchar *pattern, TMParserType lang, GHashTable *file_names,
+	gint bonus, guint max_num)
+{
+	guint64 pattern_chars = name_char_mask(pattern);
+	TMTagType preferred_types = TM_GLOBAL_TYPE_MASK | tm_tag_function_t |
+		tm_tag_method_t | tm_tag_macro_t | tm_tag_macro_with_arg_t;
+	gint i;
+
+	for (i = 0; i < TM_PARSER_COUNT; i++)
+	{
+		TMNameIndex *index = indexes[i];
+		guint j;
+
+		if (!index || !tm_tag_langs_compatible(lang, i))
+			continue;
+
+		for (j = 0; j < index->entries->len; j++)
+		{
+			TMNameEntry *entry = &NAME_ENTRY(index, j);
+			gint score;
+
+			if ((entry->chars & pattern_chars) != pattern_chars)
+				continue;
+
+			score = MAX(fuzzy_score(entry->name, pattern, TRUE),
+				fuzzy_score(entry->name, pattern, FALSE));
+			if (score < 0)
+				continue;
+
+			score += bonus;
+			if (entry->types & preferred_types)
+				score += FUZZY_TYPE;
+			if (file_names && g_hash_table_lookup(file_names, entry->name))
+				score += FUZZY_SAME_FILE;
+			add_fuzzy_match(matches, entry->name, score, max_num);
+		}
+	}
+}
+
+
+/* Returns tags whose names contain the characters of pattern in the same order,
+ not necessarily adjacent, e.g. "gtkwid" matches "gtk_widget_show". Matches at
+ the start of words, runs of consecutive characters and names defined in
+ current_file score higher. There is only one tag for each name.
+ @param pattern The characters to look for, compared case-insensitively.
+ @param lang Specifies the language(see the table in parsers.h) of the tags to be found.
+ @param current_file The file being edited, or NULL.
+ @param max_num The maximum number of tags to return.
+ @return Array of matching tags sorted by their score, the best first.
+*/
+GPtrArray *tm_workspace_find_fuzzy(const char *pattern, TMParserType lang,
+	TMSourceFile *current_file, guint max_num)
+{
+	GPtrArray *tags = g_ptr_array_new();
+	GHashTable *file_names = NULL;
+	GArray *matches;
+	guint i;
+
+	if (!pattern || !*pattern || max_num == 0)
+		return tags;
+
+	if (current_file && current_file->tags_array)
+	{
+		file_names = g_hash_table_new(g_direct_hash, g_direct_equal);
+		for (i = 0; i < current_file->tags_array->len; i++)
+		{
+			TMTag *tag = current_file->tags_array->pdata[i];
+
+			g_hash_table_insert(file_names, tag->name, tag->name);
+		}
+	}
+
+	matches = g_array_sized_new(FALSE, FALSE, sizeof(TMFuzzyMatch), max_num + 1);
+	name_index_find_fuzzy(matches, workspace_names, pattern, lang, file_names,
+		FUZZY_WORKSPACE, max_num);
+	name_index_find_fuzzy(matches, global_names, pattern, lang, NULL, 0, max_num);
+
+	for (i = 0; i < matches->len; i++)
+	{
+		const gchar *name = g_array_index(matches, TMFuzzyMatch, i).name;
+		TMTag *tag = NULL;
+
+		if (current_file && current_file->tags_array)
+			tag = find_prefix_tag(current_file->tags_array, name, lang);
+		if (!tag)
+			tag = find_prefix_tag(theWorkspace->tags_array, name, lang);
+		if (!tag)
+			tag = find_prefix_tag(theWorkspace->global_tags, name, lang);
+		if (tag)
+			g_ptr_array_add(tags, tag);
+	}
+
+	g_array_free(matches, TRUE);
+	if (file_names)
+		g_hash_table_destroy(file_names);
+	return tags;
+}
+
+
 /* Gets all members of type_tag; search them inside the all array.
  * The namespace parameter determines whether we are performing the "namespace"
  * search (user has typed something like "A::" where A is a type) or "scope" search
@@ -782,7 +1997,14 @@ find_scope_members_tags (const GPtrArray *all, TMTag *type_tag, gboolean namespa
 	else
 		scope = g_strdup(type_tag->name);
 
-	for (i = 0; i < all->len; ++i)
+	/* the workspace and global arrays are too big to be scanned - only look
+	 * at the tags with the searched scope */
+	if (all == theWorkspace->tags_array)
+		all = g_hash_table_lookup(workspace_scopes, scope);
+	else if (all == theWorkspace->global_tags)
+		all = g_hash_table_lookup(global_scopes, scope);
+
+	for (i = 0; all && i < all->len; ++i)
 	{
 		TMTag *tag = TM_TAG (all->pdata[i]);
 
@@ -1073,8 +2295,9 @@ tm_workspace_find_scope_members (TMSourceFile *source_file, const char *name,
 		g_ptr_array_free(tags, TRUE);
 	}
 
+	/* tags found in the member index aren't sorted */
 	if (member_tags)
-		tm_tags_dedup(member_tags, sort_attr, FALSE);
+		tm_tags_sort(member_tags, sort_attr, TRUE, FALSE);
 
 	return member_tags;
 }
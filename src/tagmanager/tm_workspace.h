@@ -45,18 +45,26 @@ void tm_workspace_remove_source_files(GPtrArray *source_files);
 
 #ifdef GEANY_PRIVATE
 
+typedef void (*TMWorkspaceUpdateCallback) (TMSourceFile *source_file, gpointer user_data);
+
 const TMWorkspace *tm_get_workspace(void);
 
 gboolean tm_workspace_load_global_tags(const char *tags_file, TMParserType mode);
 
 gboolean tm_workspace_create_global_tags(const char *pre_process, const char **includes,
-	int includes_count, const char *tags_file, TMParserType lang);
+	int includes_count, const char *tags_file, TMParserType lang, gboolean binary);
+
+gboolean tm_workspace_convert_global_tags(const char *in_file, const char *tags_file,
+	TMParserType lang, gboolean binary);
 
 GPtrArray *tm_workspace_find(const char *name, const char *scope, TMTagType type,
 	TMTagAttrType *attrs, TMParserType lang);
 
 GPtrArray *tm_workspace_find_prefix(const char *prefix, TMParserType lang, guint max_num);
 
+GPtrArray *tm_workspace_find_fuzzy(const char *pattern, TMParserType lang,
+	TMSourceFile *current_file, guint max_num);
+
 GPtrArray *tm_workspace_find_scope_members (TMSourceFile *source_file, const char *name,
 	gboolean function, gboolean member, const gchar *current_scope, gboolean search_namespace);
 
@@ -66,6 +74,24 @@ void tm_workspace_add_source_file_noupdate(TMSourceFile *source_file);
 void tm_workspace_update_source_file_buffer(TMSourceFile *source_file, guchar* text_buf,
 	gsize buf_size);
 
+void tm_workspace_update_source_file_buffer_async(TMSourceFile *source_file, guchar* text_buf,
+	gsize buf_size, TMWorkspaceUpdateCallback callback, gpointer user_data);
+
+void tm_workspace_cancel_source_file_update(TMSourceFile *source_file);
+
+void tm_workspace_parse_source_file(TMSourceFile *source_file);
+
+void tm_workspace_add_parsed_source_files(GPtrArray *source_files);
+
+gboolean tm_workspace_is_typename(const gchar *name, TMParserType lang);
+
+GPtrArray *tm_workspace_take_typename_changes(TMParserType lang);
+
+void tm_workspace_set_tags_cache_dir(const gchar *cache_dir);
+
+gboolean tm_workspace_update_source_file_from_cache(TMSourceFile *source_file,
+	time_t mtime, gsize size);
+
 void tm_workspace_free(void);
 
 
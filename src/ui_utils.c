@@ -2332,6 +2332,8 @@ void ui_init_prefs(void)
 		"msgwin_messages_visible", TRUE);
 	stash_group_add_boolean(group, &interface_prefs.msgwin_scribble_visible,
 		"msgwin_scribble_visible", TRUE);
+	stash_group_add_integer(group, &ui_prefs.msgwin_max_lines,
+		"msgwin_max_lines", 100000);
 }
 
 
@@ -2725,6 +2727,8 @@ gpointer ui_builder_get_object (const gchar *name)
 
 /* Progress Bar */
 static guint progress_bar_timer_id = 0;
+/* the user of the progressbar while it shows a fraction, see ui_progress_bar_set_fraction() */
+static gconstpointer progress_bar_owner = NULL;
 
 
 static GtkWidget *progress_bar_create(void)
@@ -2773,6 +2777,7 @@ void ui_progress_bar_start(const gchar *text)
 	if (! interface_prefs.statusbar_visible)
 		return;
 
+	ui_progress_bar_take();
 	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(main_widgets.progressbar), text);
 
 	progress_bar_timer_id = g_timeout_add(200, progress_bar_pulse, NULL);
@@ -2789,6 +2794,7 @@ GEANY_API_SYMBOL
 void ui_progress_bar_stop(void)
 {
 	gtk_widget_hide(GTK_WIDGET(main_widgets.progressbar));
+	progress_bar_owner = NULL;
 
 	if (progress_bar_timer_id != 0)
 	{
@@ -2798,6 +2804,54 @@ void ui_progress_bar_stop(void)
 }
 
 
+/* Takes the progressbar away from the owner of a fraction, for users which show it
+ * themselves. The owner finds out on its next update. */
+void ui_progress_bar_take(void)
+{
+	progress_bar_owner = NULL;
+}
+
+
+/* Shows the fraction of the work done by owner in the progressbar, taking it if it isn't
+ * used. Returns whether owner has the progressbar. */
+gboolean ui_progress_bar_set_fraction(gconstpointer owner, const gchar *text, gdouble fraction)
+{
+	GtkProgressBar *bar = GTK_PROGRESS_BAR(main_widgets.progressbar);
+
+	g_return_val_if_fail(owner != NULL, FALSE);
+
+	if (progress_bar_owner != owner)
+	{
+		/* don't take over the progressbar when something else uses it */
+		if (progress_bar_owner != NULL || progress_bar_timer_id != 0 ||
+			! interface_prefs.statusbar_visible || gtk_widget_get_visible(GTK_WIDGET(bar)))
+			return FALSE;
+		progress_bar_owner = owner;
+		gtk_progress_bar_set_text(bar, text);
+		gtk_widget_show(GTK_WIDGET(bar));
+	}
+	else if (! gtk_widget_get_visible(GTK_WIDGET(bar)))
+	{
+		/* hidden by a plugin using the widget directly */
+		progress_bar_owner = NULL;
+		return FALSE;
+	}
+	gtk_progress_bar_set_fraction(bar, fraction);
+	return TRUE;
+}
+
+
+/* Hides the progressbar if owner still has it */
+void ui_progress_bar_release(gconstpointer owner)
+{
+	if (owner == NULL || progress_bar_owner != owner)
+		return;
+
+	progress_bar_owner = NULL;
+	gtk_widget_hide(GTK_WIDGET(main_widgets.progressbar));
+}
+
+
 static gint compare_menu_item_labels(gconstpointer a, gconstpointer b)
 {
 	GtkMenuItem *item_a = GTK_MENU_ITEM(a);
@@ -166,6 +166,7 @@ typedef struct UIPrefs
 	gboolean	allow_always_save; /* if set, files can always be saved, even if unchanged */
 	gchar		*statusbar_template;
 	gboolean	new_document_after_close;
+	gint		msgwin_max_lines;	/* rows kept in the compiler and messages tabs, 0 for all */
 
 	/* Menu-item related data */
 	GQueue		*recent_queue;
@@ -361,6 +362,12 @@ gint ui_encodings_combo_box_get_active_encoding(GtkComboBox *combo);
 
 gboolean ui_encodings_combo_box_set_active_encoding(GtkComboBox *combo, gint enc);
 
+void ui_progress_bar_take(void);
+
+gboolean ui_progress_bar_set_fraction(gconstpointer owner, const gchar *text, gdouble fraction);
+
+void ui_progress_bar_release(gconstpointer owner);
+
 #endif /* GEANY_PRIVATE */
 
 G_END_DECLS
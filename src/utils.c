@@ -715,6 +715,41 @@ gint utils_strpos(const gchar *haystack, const gchar *needle)
 }
 
 
+/* Returns the number of threads to use for work split across processors */
+guint utils_get_thread_count(void)
+{
+	guint thread_count = 4;
+
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	thread_count = g_get_num_processors();
+#endif
+	return MAX(1, thread_count);
+}
+
+
+/* Returns the first occurrence of needle in the len bytes of haystack, or NULL.
+ * Unlike strstr() the text may contain NUL bytes. memchr() skips most of the text
+ * and is vectorized by common C libraries. */
+const gchar *utils_find_bytes(const gchar *haystack, gsize len, const gchar *needle, gsize needle_len)
+{
+	const gchar *end = haystack + len;
+	const gchar *p = haystack;
+
+	g_return_val_if_fail(needle_len > 0, NULL);
+
+	while (needle_len <= (gsize) (end - p))
+	{
+		p = memchr(p, (guchar) needle[0], (end - p) - needle_len + 1);
+		if (!p)
+			return NULL;
+		if (memcmp(p + 1, needle + 1, needle_len - 1) == 0)
+			return p;
+		p++;
+	}
+	return NULL;
+}
+
+
 /**
  *  Retrieves a formatted date/time string from strftime().
  *  This function should be preferred to directly calling strftime() since this function
@@ -266,6 +266,10 @@ void utils_str_replace_all(gchar **haystack, const gchar *needle, const gchar *r
 
 gint utils_strpos(const gchar* haystack, const gchar *needle);
 
+guint utils_get_thread_count(void);
+
+const gchar *utils_find_bytes(const gchar *haystack, gsize len, const gchar *needle, gsize needle_len);
+
 gchar *utils_get_initials(const gchar *name);
 
 gchar *utils_get_hex_from_color(GdkColor *color);
@@ -0,0 +1,257 @@
+/*
+ *      wordindex.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2026 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Index of the words of a document, for document word autocompletion.
+ *
+ * The index counts how often each word occurs and keeps the distinct words sorted,
+ * so the words starting with a prefix are next to each other. It is built when
+ * words are first requested and then kept up to date from the SCN_MODIFIED
+ * notifications: the words around a change are removed before it and added again
+ * after it. Word boundaries are asked from Scintilla, so they are the same as for
+ * its word searches.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "wordindex.h"
+
+#include "sciwrappers.h"
+#include "utils.h"
+
+#include <string.h>
+
+
+/* changes bigger than this drop the index instead of updating it, it is rebuilt on
+ * the next request. This keeps reloading or replacing a whole document fast. */
+#define MAX_UPDATE_LENGTH	65536
+
+#define WORD_INDEX_KEY	"geany-word-index"
+
+
+typedef struct
+{
+	gchar *word;
+	guint count;
+	GSequenceIter *iter;	/* position in WordIndex::sorted */
+}
+WordEntry;
+
+typedef struct
+{
+	GHashTable *entries;	/* word -> WordEntry */
+	GSequence *sorted;		/* WordEntry, sorted by word */
+}
+WordIndex;
+
+typedef void (*WordFunc)(WordIndex *index, gchar *word);
+
+
+static void word_entry_free(gpointer data)
+{
+	WordEntry *entry = data;
+
+	g_free(entry->word);
+	g_slice_free(WordEntry, entry);
+}
+
+
+static gint compare_entries(gconstpointer a, gconstpointer b, gpointer data)
+{
+	return strcmp(((const WordEntry *) a)->word, ((const WordEntry *) b)->word);
+}
+
+
+static void word_index_free(gpointer data)
+{
+	WordIndex *index = data;
+
+	g_sequence_free(index->sorted);
+	g_hash_table_destroy(index->entries);
+	g_slice_free(WordIndex, index);
+}
+
+
+/* takes ownership of word */
+static void add_word(WordIndex *index, gchar *word)
+{
+	WordEntry *entry = g_hash_table_lookup(index->entries, word);
+
+	if (entry)
+	{
+		entry->count++;
+		g_free(word);
+		return;
+	}
+	entry = g_slice_new(WordEntry);
+	entry->word = word;
+	entry->count = 1;
+	entry->iter = g_sequence_insert_sorted(index->sorted, entry, compare_entries, NULL);
+	g_hash_table_insert(index->entries, entry->word, entry);
+}
+
+
+static void remove_word(WordIndex *index, gchar *word)
+{
+	WordEntry *entry = g_hash_table_lookup(index->entries, word);
+
+	g_free(word);
+	if (!entry)
+		return;
+	if (--entry->count == 0)
+	{
+		g_sequence_remove(entry->iter);
+		/* frees the entry */
+		g_hash_table_remove(index->entries, entry->word);
+	}
+}
+
+
+/* Calls func for each word in [start, end), which must not begin or end inside a word */
+static void foreach_word(WordIndex *index, ScintillaObject *sci, gint start, gint end, WordFunc func)
+{
+	gint pos = start;
+
+	while (pos < end)
+	{
+		gint word_end = sci_word_end_position(sci, pos, TRUE);
+
+		if (word_end > pos)
+		{
+			func(index, sci_get_contents_range(sci, pos, word_end));
+			pos = word_end;
+		}
+		else
+		{
+			/* skip the following characters of the same class */
+			gint next = sci_word_end_position(sci, pos, FALSE);
+
+			pos = (next > pos) ? next :
+				(gint) scintilla_send_message(sci, SCI_POSITIONAFTER, pos, 0);
+		}
+	}
+}
+
+
+static WordIndex *word_index_build(ScintillaObject *sci)
+{
+	WordIndex *index = g_slice_new(WordIndex);
+
+	/* the sequence frees the entries, the hash table only references them */
+	index->sorted = g_sequence_new(word_entry_free);
+	index->entries = g_hash_table_new(g_str_hash, g_str_equal);
+	foreach_word(index, sci, 0, sci_get_length(sci), add_word);
+	return index;
+}
+
+
+/* Updates the index of sci for an SCN_MODIFIED notification, if there is one */
+void word_index_update(ScintillaObject *sci, const SCNotification *nt)
+{
+	WordIndex *index = g_object_get_data(G_OBJECT(sci), WORD_INDEX_KEY);
+	gint type = nt->modificationType;
+	gint pos = nt->position;
+
+	if (!index || !(type & (SC_MOD_BEFOREINSERT | SC_MOD_INSERTTEXT |
+		SC_MOD_BEFOREDELETE | SC_MOD_DELETETEXT)))
+		return;
+
+	if (nt->length > MAX_UPDATE_LENGTH)
+	{
+		word_index_invalidate(sci);
+		return;
+	}
+
+	/* remove the words around the change before it's done, and add the words
+	 * around it afterwards */
+	if (type & SC_MOD_BEFOREINSERT)
+		foreach_word(index, sci, sci_word_start_position(sci, pos, TRUE),
+			sci_word_end_position(sci, pos, TRUE), remove_word);
+	else if (type & SC_MOD_INSERTTEXT)
+		foreach_word(index, sci, sci_word_start_position(sci, pos, TRUE),
+			sci_word_end_position(sci, pos + nt->length, TRUE), add_word);
+	else if (type & SC_MOD_BEFOREDELETE)
+		foreach_word(index, sci, sci_word_start_position(sci, pos, TRUE),
+			sci_word_end_position(sci, pos + nt->length, TRUE), remove_word);
+	else
+		foreach_word(index, sci, sci_word_start_position(sci, pos, TRUE),
+			sci_word_end_position(sci, pos, TRUE), add_word);
+}
+
+
+/* Drops the index of sci, e.g. when the word characters changed */
+void word_index_invalidate(ScintillaObject *sci)
+{
+	g_object_set_data(G_OBJECT(sci), WORD_INDEX_KEY, NULL);
+}
+
+
+/* Returns a list of the words of sci starting with root, but longer, sorted
+ * case-insensitively. The word at exclude_pos is left out unless it occurs elsewhere.
+ * The list and its strings should be freed. */
+GSList *word_index_get_words(ScintillaObject *sci, const gchar *root, gint exclude_pos,
+		guint max_words)
+{
+	WordIndex *index = g_object_get_data(G_OBJECT(sci), WORD_INDEX_KEY);
+	WordEntry key = { (gchar *) root, 0, NULL };
+	gchar *excluded = NULL;
+	GSequenceIter *iter;
+	GSList *words = NULL;
+	gsize root_len = strlen(root);
+	guint n_words = 0;
+
+	if (!index)
+	{
+		index = word_index_build(sci);
+		g_object_set_data_full(G_OBJECT(sci), WORD_INDEX_KEY, index, word_index_free);
+	}
+
+	if (exclude_pos >= 0)
+	{
+		WordEntry *entry;
+
+		excluded = sci_get_contents_range(sci, exclude_pos,
+			sci_word_end_position(sci, exclude_pos, TRUE));
+		entry = g_hash_table_lookup(index->entries, excluded);
+		/* the word also occurs elsewhere */
+		if (entry && entry->count > 1)
+			SETPTR(excluded, NULL);
+	}
+
+	/* the words starting with root follow it in the sorted sequence */
+	iter = g_sequence_search(index->sorted, &key, compare_entries, NULL);
+	for (; !g_sequence_iter_is_end(iter) && n_words < max_words; iter = g_sequence_iter_next(iter))
+	{
+		WordEntry *entry = g_sequence_get(iter);
+
+		if (strncmp(entry->word, root, root_len) != 0)
+			break;
+		if (entry->word[root_len] == 0 || g_strcmp0(entry->word, excluded) == 0)
+			continue;
+
+		words = g_slist_prepend(words, g_strdup(entry->word));
+		n_words++;
+	}
+	g_free(excluded);
+
+	return g_slist_sort(words, (GCompareFunc) utils_str_casecmp);
+}
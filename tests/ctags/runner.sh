@@ -23,3 +23,11 @@ tagfile="$TMPDIR/test.${source##*.}.tags"
 
 "$GEANY" -c "$CONFDIR" -P -g "$tagfile" "$source" || exit 1
 diff -u "$result" "$tagfile" || exit 2
+
+# write the tags in the binary format, read them back and compare again
+binfile="$TMPDIR/binary.${source##*.}.tags"
+roundtrip="$TMPDIR/roundtrip.${source##*.}.tags"
+
+"$GEANY" -c "$CONFDIR" -P -g --binary-tags "$binfile" "$source" || exit 3
+"$GEANY" -c "$CONFDIR" -g "$roundtrip" "$binfile" || exit 4
+diff -u "$result" "$roundtrip" || exit 5